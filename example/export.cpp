@@ -0,0 +1,61 @@
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <sstream>
+#include <cmath>
+#include <iomanip>
+
+#include "mlp/network.hpp"
+#include "mlp/export.hpp"
+
+int main(int argc, char *argv[]) {
+
+    using namespace mlp;
+
+    if(argc != 3 && argc != 4) {
+        std::cerr << "Invalid input, try: " << argv[0] << " iris.csv iris_model.hpp [model.txt]\n";
+        return 1;
+    }
+
+    samples_vec_t data;
+    labels_vec_t labels;
+
+    load_csv(argv[1], 4, data, labels);
+    normalize(data, 0, 1.0);
+
+    try {
+        network<> nn({4,6,6,3});
+        nn.alpha = 0.02;
+        nn.on_epoch = [&]() {
+            return nn.test(data, labels).accuracy >= 0.98f;
+        };
+        nn.train(data, labels, 25000);
+
+        std::cout << "Trained accuracy: " << nn.test(data, labels).accuracy * 100.0f << "%\n";
+
+        /**
+         * Write the trained network as a standalone header, which can be
+         * included and called as iris_model::classify(features)
+         */
+        std::ofstream out(argv[2]);
+        export_cpp(nn, out, "iris_model");
+        if(!out) {
+            throw mlp_error{"failed to write " + std::string(argv[2])};
+        }
+        std::cout << "Exported network to " << argv[2] << "\n";
+
+        /**
+         * Optionally save the network, e.g., for export_check.cpp to compare
+         * against the exported header
+         */
+        if(argc == 4) {
+            std::ofstream model(argv[3]);
+            nn.save(model);
+        }
+
+    }catch(mlp_error& err) {
+        std::cout << "Error occured: " << err.why << "\n\n";
+        return 1;
+    }
+}
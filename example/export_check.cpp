@@ -0,0 +1,73 @@
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <sstream>
+#include <cmath>
+#include <iomanip>
+#include <algorithm>
+
+#include "mlp/network.hpp"
+
+/**
+ * Generated by export.cpp, see the Makefile's test target
+ */
+#include "example/iris_model.hpp"
+
+/**
+ * Checks that the exported iris_model header matches the network it was
+ * exported from
+ */
+int main(int argc, char *argv[]) {
+
+    using namespace mlp;
+
+    if(argc != 3) {
+        std::cerr << "Invalid input, try: " << argv[0] << " model.txt iris.csv\n";
+        return 1;
+    }
+
+    samples_vec_t data;
+    labels_vec_t labels;
+
+    load_csv(argv[2], 4, data, labels);
+    normalize(data, 0, 1.0);
+
+    try {
+        std::ifstream model(argv[1]);
+        if(!model) {
+            throw mlp_error{"failed to open " + std::string(argv[1])};
+        }
+        auto nn = network<>::load(model);
+
+        if(iris_model::input_size != nn.input_size() || iris_model::output_size != nn.output_size()) {
+            throw mlp_error{"exported dimensions do not match the network"};
+        }
+
+        const float_t tolerance = 1e-5;
+        float_t max_diff = 0;
+        size_t mismatched = 0;
+        float output[iris_model::output_size];
+        for(const auto& row : data) {
+            nn.forward(row);
+            iris_model::predict(row.data(), output);
+            for(size_t i = 0; i < iris_model::output_size; ++i) {
+                max_diff = std::max(max_diff, std::abs(nn.output()[i] - output[i]));
+            }
+            const auto best = std::max_element(nn.output().begin(), nn.output().end()) - nn.output().begin();
+            if(iris_model::classify(row.data()) != static_cast<size_t>(best)) {
+                ++mismatched;
+            }
+        }
+
+        const bool passed = max_diff <= tolerance && mismatched == 0;
+        std::cout << (passed ? "PASS " : "FAIL ") << "exported predict against network::forward"
+                  << ", max error: " << std::scientific << max_diff
+                  << ", mismatched labels: " << mismatched << "\n";
+        return passed ? 0 : 1;
+
+    }catch(mlp_error& err) {
+        std::cout << "Error occured: " << err.why << "\n\n";
+        return 1;
+    }
+}
@@ -0,0 +1,105 @@
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <sstream>
+#include <cmath>
+#include <iomanip>
+
+#include "mlp/network.hpp"
+#include "mlp/gradient_check.hpp"
+
+using namespace mlp;
+
+/**
+ * Prints a gradient check, returning whether it passed
+ */
+bool report(const std::string& name, const gradient_check_results& res) {
+    std::cout << (res.passed ? "PASS " : "FAIL ") << std::left << std::setw(48) << name << std::right
+              << " checked: " << std::setw(5) << res.checked
+              << ", max abs error: " << std::scientific << res.max_abs_error
+              << ", max rel error: " << res.max_rel_error << std::fixed << "\n";
+    return res.passed;
+}
+
+template<typename Activation, typename LossFunction>
+bool run_network_checks(const std::string& name) {
+    bool passed = true;
+    for(const auto& dims : std::vector<std::vector<size_t>>{{4, 3}, {5, 8, 3}, {17, 33, 9, 4}}) {
+        std::string label = name;
+        for(size_t i = 0; i < dims.size(); ++i) {
+            label += (i ? "-" : " ") + std::to_string(dims[i]);
+        }
+        passed &= report(label, check_gradients<Activation, LossFunction>(dims));
+    }
+    return passed;
+}
+
+/**
+ * Prints a kernel check
+ */
+void print_kernel(const std::string& name, const kernel_check_results& res) {
+    std::cout << (res.passed ? "PASS " : "FAIL ") << std::left << std::setw(48) << name << std::right
+              << " max error: " << std::scientific << res.max_error << std::fixed
+              << ", " << std::setw(10) << res.reference_us << " us -> " << std::setw(10) << res.variant_us << " us";
+    if(res.baseline) {
+        std::cout << " (baseline, same loops as the reference)\n";
+    } else {
+        std::cout << " (speedup " << res.speedup() << "x)\n";
+    }
+}
+
+template<typename Activation>
+bool run_kernel_checks(const std::string& name) {
+    bool passed = true;
+    for(const auto& size : std::vector<std::pair<size_t, size_t>>{{8, 8}, {37, 19}, {512, 256}, {784, 1024}}) {
+        for(const auto& res : check_kernels<Activation>(size.first, size.second)) {
+            print_kernel(name + " " + res.name + " " + std::to_string(size.first) + "x" + std::to_string(size.second), res);
+            passed &= res.passed;
+        }
+    }
+    for(const auto& dims : std::vector<std::vector<size_t>>{{4, 3}, {17, 33, 9, 4}, {784, 1024, 256, 10}}) {
+        std::string label;
+        for(size_t i = 0; i < dims.size(); ++i) {
+            label += (i ? "-" : " ") + std::to_string(dims[i]);
+        }
+        for(const auto& res : check_frozen<Activation>(dims)) {
+            print_kernel(name + " " + res.name + label, res);
+            passed &= res.passed;
+        }
+    }
+    return passed;
+}
+
+int main() {
+
+    std::cout << std::setprecision(2) << std::fixed;
+
+    try {
+        bool passed = true;
+
+        std::cout << "Loss gradients:\n";
+        passed &= report("error_loss", check_loss<error_loss>(16));
+        passed &= report("absolute_loss", check_loss<absolute_loss>(16));
+        passed &= report("mse_loss", check_loss<mse_loss>(16));
+
+        std::cout << "\nNetwork gradients:\n";
+        passed &= run_network_checks<sigmoid_activation, error_loss>("sigmoid/error_loss");
+        passed &= run_network_checks<sigmoid_activation, absolute_loss>("sigmoid/absolute_loss");
+        passed &= run_network_checks<sigmoid_activation, mse_loss>("sigmoid/mse_loss");
+        passed &= run_network_checks<tanh_activation, error_loss>("tanh/error_loss");
+        passed &= run_network_checks<tanh_activation, absolute_loss>("tanh/absolute_loss");
+        passed &= run_network_checks<tanh_activation, mse_loss>("tanh/mse_loss");
+
+        std::cout << "\nKernels against reference loops:\n";
+        passed &= run_kernel_checks<sigmoid_activation>("sigmoid");
+        passed &= run_kernel_checks<tanh_activation>("tanh");
+
+        std::cout << "\n" << (passed ? "All checks passed" : "Some checks FAILED") << "\n";
+        return passed ? 0 : 1;
+
+    }catch(mlp_error& err) {
+        std::cout << "Error occured: " << err.why << "\n\n";
+        return 1;
+    }
+}
@@ -11,8 +11,8 @@ int main(int argc, char *argv[]) {
 
     using namespace mlp;
 
-    if(argc != 2) {
-        std::cerr << "Invalid input, try: " << argv[0] << " iris.csv\n";
+    if(argc != 2 && argc != 3) {
+        std::cerr << "Invalid input, try: " << argv[0] << " iris.csv [model.txt]\n";
         return 1;
     }
 
@@ -54,6 +54,14 @@ int main(int argc, char *argv[]) {
 
         std::cout << "Final Accuracy: " << nn.test(data, labels).accuracy * 100.0f << "%\n";
 
+        /**
+         * Optionally save the trained network, e.g., for server.cpp
+         */
+        if(argc == 3) {
+            std::ofstream model(argv[2]);
+            nn.save(model);
+        }
+
     }catch(mlp_error& err) {
         std::cout << "Error occured: " << err.why << "\n\n";
     }
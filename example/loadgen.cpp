@@ -0,0 +1,113 @@
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <sstream>
+#include <cmath>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+#include <algorithm>
+
+#include "mlp/network.hpp"
+#include "mlp/server.hpp"
+
+int main(int argc, char *argv[]) {
+
+    using namespace mlp;
+    using clock = std::chrono::steady_clock;
+
+    if(argc < 3 || argc > 5) {
+        std::cerr << "Invalid input, try: " << argv[0]
+                  << " unix:/tmp/mlp.sock|tcp:<port> iris.csv [clients] [requests_per_client]\n";
+        return 1;
+    }
+
+    const std::string address = argv[1];
+
+    samples_vec_t data;
+    labels_vec_t labels;
+
+    load_csv(argv[2], 4, data, labels);
+    normalize(data, 0, 1.0);
+
+    try {
+        const size_t clients = argc > 3 ? std::stoul(argv[3]) : 16;
+        const size_t count = argc > 4 ? std::stoul(argv[4]) : 1000;
+        if(clients == 0 || count == 0) {
+            throw mlp_error{"clients and requests_per_client must be greater than 0"};
+        }
+
+        /**
+         * Each client sends its requests back to back, recording the round
+         * trip latency and whether the label was predicted correctly
+         */
+        std::vector<std::vector<double>> latencies(clients);
+        std::vector<size_t> correct(clients, 0);
+        std::vector<std::string> errors(clients);
+        std::vector<std::thread> threads;
+
+        auto start = clock::now();
+        for(size_t c = 0; c < clients; ++c) {
+            threads.emplace_back([&, c]() {
+                try {
+                    inference_client client(address);
+                    vec_t output;
+                    latencies[c].reserve(count);
+                    for(size_t i = 0; i < count; ++i) {
+                        const size_t row = (c * count + i) % data.size();
+                        auto sent = clock::now();
+                        size_t label = client.predict(data[row], output);
+                        std::chrono::duration<double, std::micro> rtt = clock::now() - sent;
+                        latencies[c].push_back(rtt.count());
+                        if(label == labels[row]) {
+                            ++correct[c];
+                        }
+                    }
+                } catch(mlp_error& err) {
+                    errors[c] = err.why;
+                }
+            });
+        }
+        for(auto& t : threads) {
+            t.join();
+        }
+        std::chrono::duration<double> elapsed = clock::now() - start;
+
+        for(const auto& err : errors) {
+            if(!err.empty()) {
+                throw mlp_error{err};
+            }
+        }
+
+        std::vector<double> all;
+        size_t total_correct = 0;
+        for(size_t c = 0; c < clients; ++c) {
+            all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+            total_correct += correct[c];
+        }
+        std::sort(all.begin(), all.end());
+
+        std::cout << std::setprecision(2) << std::fixed;
+        std::cout << "Requests: " << all.size() << " from " << clients << " clients in " << elapsed.count() << " s\n"
+                  << "Throughput: " << all.size() / elapsed.count() << " req/s\n"
+                  << "Latency p50: " << all[all.size() / 2] << " us"
+                  << ", p99: " << all[all.size() * 99 / 100] << " us"
+                  << ", max: " << all.back() << " us\n"
+                  << "Accuracy: " << 100.0 * total_correct / all.size() << "%\n";
+
+        inference_client client(address);
+        std::cout << "Server: " << client.stats() << "\n";
+
+    }catch(mlp_error& err) {
+        std::cout << "Error occured: " << err.why << "\n\n";
+        return 1;
+    }catch(std::invalid_argument&) {
+        std::cout << "Error occured: numeric arguments must be integers\n\n";
+        return 1;
+    }catch(std::out_of_range&) {
+        std::cout << "Error occured: numeric argument out of range\n\n";
+        return 1;
+    }
+}
@@ -0,0 +1,109 @@
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <sstream>
+#include <cmath>
+#include <iomanip>
+#include <chrono>
+#include <stdexcept>
+
+#include "mlp/network.hpp"
+#include "mlp/numa.hpp"
+
+using namespace mlp;
+
+/**
+ * Trains the network on the samples for a number of epochs, returning the
+ * mean time per sample in microseconds
+ */
+template<typename Network>
+double time_train(Network& nn, const samples_vec_t& data, const labels_vec_t& labels, size_t epochs) {
+    auto start = std::chrono::steady_clock::now();
+    nn.train(data, labels, epochs);
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (epochs * data.size());
+}
+
+int main(int argc, char *argv[]) {
+
+    if(argc > 3) {
+        std::cerr << "Invalid input, try: " << argv[0] << " [max_nodes] [threads_per_node]\n";
+        return 1;
+    }
+
+    std::cout << std::setprecision(4) << std::fixed;
+
+    try {
+        const size_t max_nodes = argc > 1 ? std::stoul(argv[1]) : 4;
+        const size_t threads_per_node = argc > 2 ? std::stoul(argv[2]) : 1;
+
+        auto detected = numa_topology::detect();
+        std::cout << "Detected " << detected.size() << " NUMA node(s)\n";
+        for(size_t n = 0; n < detected.size(); ++n) {
+            std::cout << "  node " << n << ": " << detected.nodes[n].size() << " CPU(s)\n";
+        }
+
+        /**
+         * Random samples for a network with large hidden layers
+         */
+        const std::vector<size_t> dims{512, 2048, 2048, 10};
+        samples_vec_t data(32, vec_t(dims.front()));
+        labels_vec_t labels(data.size());
+        std::uniform_real_distribution<float_t> dist(0, 1);
+        for(size_t i = 0; i < data.size(); ++i) {
+            for(auto& v : data[i]) {
+                v = dist(random_generator::get());
+            }
+            labels[i] = i % dims.back();
+        }
+
+        network<> reference(dims);
+        reference.alpha = 0.01;
+        network<> dense = reference;
+        const double dense_us = time_train(dense, data, labels, 2);
+        std::cout << "\nDense training: " << dense_us << " us/sample\n";
+
+        /**
+         * Train copies of the same network partitioned across simulated nodes,
+         * which must match the dense network up to rounding. Summing the input
+         * gradients per partition rounds differently, and training amplifies
+         * this to around 1e-4, whereas a wrongly partitioned layer is off by
+         * orders of magnitude more.
+         */
+        const float_t tolerance = 1e-3;
+        bool passed = true;
+        for(size_t nodes = 1; nodes <= max_nodes; nodes *= 2) {
+            node_pool pool(numa_topology::simulated(nodes), threads_per_node);
+            network<> partitioned = reference;
+            partitioned.partition(pool);
+            const double us = time_train(partitioned, data, labels, 2);
+
+            float_t max_diff = 0;
+            for(const auto& row : data) {
+                dense.forward(row);
+                partitioned.forward(row);
+                for(size_t i = 0; i < dense.output().size(); ++i) {
+                    max_diff = std::max(max_diff, std::abs(dense.output()[i] - partitioned.output()[i]));
+                }
+            }
+            std::cout << "Partitioned across " << nodes << " simulated node(s)"
+                      << " with " << threads_per_node << " thread(s) each: " << us << " us/sample"
+                      << " (speedup " << dense_us / us << "x), max output difference: "
+                      << std::scientific << max_diff << std::fixed
+                      << (max_diff > tolerance ? " FAIL" : "") << "\n";
+            passed = passed && max_diff <= tolerance;
+        }
+        return passed ? 0 : 1;
+
+    }catch(mlp_error& err) {
+        std::cout << "Error occured: " << err.why << "\n\n";
+        return 1;
+    }catch(std::invalid_argument&) {
+        std::cout << "Error occured: numeric arguments must be integers\n\n";
+        return 1;
+    }catch(std::out_of_range&) {
+        std::cout << "Error occured: numeric argument out of range\n\n";
+        return 1;
+    }
+}
@@ -0,0 +1,134 @@
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <sstream>
+#include <cmath>
+#include <iomanip>
+#include <chrono>
+
+#include "mlp/network.hpp"
+
+using namespace mlp;
+
+/**
+ * Measures the mean time of a forward pass in microseconds
+ */
+template<typename Network>
+double time_forward(Network& nn, const samples_vec_t& data, size_t repeats) {
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < repeats; ++i) {
+        for(const auto& row : data) {
+            nn.forward(row);
+        }
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (repeats * data.size());
+}
+
+/**
+ * Measures the mean time of a forward pass in microseconds, running every
+ * layer's unpruned weights through the block-sparse kernel. This isolates the
+ * speedup of sparsity from that of the vectorized kernel.
+ */
+template<typename Network>
+double time_block_forward(const Network& nn, const samples_vec_t& data, size_t repeats) {
+    std::vector<block_sparse_matrix> matrices;
+    vec_t weights;
+    size_t width = 0;
+    for(const auto& l : nn.layers) {
+        l.dense_weights(weights);
+        matrices.emplace_back(weights, l.output_size, l.input_size);
+        width = std::max(width, l.output_size);
+    }
+    vec_t a(width), b(width);
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < repeats; ++i) {
+        for(const auto& row : data) {
+            const float_t* in = row.data();
+            for(size_t l = 0; l < matrices.size(); ++l) {
+                float_t* out = l % 2 == 0 ? a.data() : b.data();
+                matrices[l].multiply(in, out);
+                for(size_t o = 0; o < nn.layers[l].output_size; ++o) {
+                    out[o] = nn.layers[l].activator.f(out[o] + nn.layers[l].bias[o]);
+                }
+                in = out;
+            }
+        }
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (repeats * data.size());
+}
+
+void print_results(const prune_results& res) {
+    std::cout << "  converted layers: " << res.converted << "/" << res.matrices
+              << ", sparsity: " << res.sparsity() * 100.0 << "%"
+              << ", blocks: " << res.kept_blocks << "/" << res.total_blocks
+              << ", size: " << res.dense_bytes / 1024 << " KiB -> " << res.sparse_bytes / 1024 << " KiB"
+              << " (" << res.compression() << "x)\n";
+}
+
+int main(int argc, char *argv[]) {
+
+    if(argc != 2) {
+        std::cerr << "Invalid input, try: " << argv[0] << " iris.csv\n";
+        return 1;
+    }
+
+    samples_vec_t data;
+    labels_vec_t labels;
+
+    load_csv(argv[1], 4, data, labels);
+    normalize(data, 0, 1.0);
+
+    std::cout << std::setprecision(4) << std::fixed;
+
+    try {
+        /**
+         * Train the iris network and prune it, reporting the accuracy lost
+         */
+        network<> nn({4,16,16,3});
+        nn.alpha = 0.02;
+        nn.on_epoch = [&]() {
+            return nn.test(data, labels).accuracy >= 0.98f;
+        };
+        nn.train(data, labels, 25000);
+
+        std::cout << "Dense accuracy: " << nn.test(data, labels).accuracy * 100.0f << "%\n";
+        auto res = nn.prune(0.25);
+        std::cout << "Pruned accuracy: " << nn.test(data, labels).accuracy * 100.0f << "%\n";
+        print_results(res);
+
+        /**
+         * Compare the forward latency of a larger, randomly initialized
+         * network at increasing sparsity
+         */
+        const std::vector<size_t> dims{784, 1024, 1024, 10};
+        samples_vec_t inputs(64, vec_t(dims.front()));
+        std::uniform_real_distribution<float_t> dist(0, 1);
+        for(auto& row : inputs) {
+            for(auto& v : row) {
+                v = dist(random_generator::get());
+            }
+        }
+
+        network<> dense(dims);
+        const double dense_us = time_forward(dense, inputs, 4);
+        const double block_us = time_block_forward(dense, inputs, 4);
+        std::cout << "\nDense forward: " << dense_us << " us\n"
+                  << "Block kernel forward at 0%: " << block_us << " us\n";
+
+        for(float_t sparsity : {0.5f, 0.75f, 0.9f}) {
+            network<> pruned = dense;
+            auto res = pruned.prune(sparsity);
+            const double pruned_us = time_forward(pruned, inputs, 4);
+            std::cout << "Pruned forward at " << sparsity * 100.0 << "%: " << pruned_us << " us"
+                      << " (speedup " << dense_us / pruned_us << "x over dense, "
+                      << block_us / pruned_us << "x over the block kernel at 0%)\n";
+            print_results(res);
+        }
+
+    }catch(mlp_error& err) {
+        std::cout << "Error occured: " << err.why << "\n\n";
+    }
+}
@@ -0,0 +1,88 @@
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <sstream>
+#include <cmath>
+#include <csignal>
+#include <stdexcept>
+
+#include <pthread.h>
+
+#include "mlp/network.hpp"
+#include "mlp/server.hpp"
+
+int main(int argc, char *argv[]) {
+
+    using namespace mlp;
+
+    if(argc < 3 || argc > 6) {
+        std::cerr << "Invalid input, try: " << argv[0]
+                  << " model.txt unix:/tmp/mlp.sock|tcp:<port> [max_batch] [latency_budget_us] [workers]\n";
+        return 1;
+    }
+
+    /**
+     * Block SIGINT and SIGTERM before starting any threads, so they can be
+     * awaited below
+     */
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    try {
+        std::ifstream model(argv[1]);
+        if(!model) {
+            throw mlp_error{"failed to open " + std::string(argv[1])};
+        }
+        auto nn = network<>::load(model);
+
+        /**
+         * The server only runs inference, so release all training state
+         */
+        auto before = nn.memory();
+        nn.freeze();
+        auto after = nn.memory();
+        std::cout << "Memory: " << before.total() << " -> " << after.total() << " bytes"
+                  << " (parameters=" << after.parameters
+                  << ", gradients=" << after.gradients
+                  << ", activations=" << after.activations << ")\n";
+
+        server_options opts;
+        opts.address = argv[2];
+        if(argc > 3) {
+            opts.max_batch = std::stoul(argv[3]);
+        }
+        if(argc > 4) {
+            opts.latency_budget = std::chrono::microseconds(std::stoul(argv[4]));
+        }
+        if(argc > 5) {
+            opts.workers = std::stoul(argv[5]);
+        }
+
+        inference_server<network<>> server(std::move(nn), opts);
+        server.start();
+        std::cout << "Serving on " << opts.address
+                  << " (max_batch=" << opts.max_batch
+                  << ", latency_budget_us=" << opts.latency_budget.count()
+                  << ", workers=" << opts.workers << ")\n";
+
+        int sig = 0;
+        sigwait(&signals, &sig);
+
+        server.stop();
+        std::cout << server.stats().to_string() << "\n";
+
+    }catch(mlp_error& err) {
+        std::cout << "Error occured: " << err.why << "\n\n";
+        return 1;
+    }catch(std::invalid_argument&) {
+        std::cout << "Error occured: numeric arguments must be integers\n\n";
+        return 1;
+    }catch(std::out_of_range&) {
+        std::cout << "Error occured: numeric argument out of range\n\n";
+        return 1;
+    }
+}
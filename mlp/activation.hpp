@@ -11,17 +11,24 @@ struct sigmoid_activation {
     /**
      * Calculates the f(x) of the sigmoid
      */
-    inline float_t f(const float_t& x) {
+    inline float_t f(const float_t& x) const {
         return float_t(1.0) / (float_t(1.0) + std::exp(-x));
     }
 
     /**
      * Calculates the f'(y) of the sigmoid, where y = f(x)
      */
-    inline float_t df(const float_t& y) {
+    inline float_t df(const float_t& y) const {
         return (float_t(1.0) - y) * y;
     }
 
+    /**
+     * C++ source of f(x), used when exporting a network
+     */
+    static const char* source() {
+        return "1.0f / (1.0f + std::exp(-x))";
+    }
+
 };
 
 /**
@@ -33,16 +40,23 @@ struct tanh_activation {
     /**
      * Calculates the f(x) of the sigmoid
      */
-    inline float_t f(const float_t& x) {
+    inline float_t f(const float_t& x) const {
         return std::tanh(x);
     }
 
     /**
      * Calculates the f'(y) of the sigmoid, where y = f(x)
      */
-    inline float_t df(const float_t& y) {
+    inline float_t df(const float_t& y) const {
         return (1.0f - y * y);
     }
+
+    /**
+     * C++ source of f(x), used when exporting a network
+     */
+    static const char* source() {
+        return "std::tanh(x)";
+    }
 };
 
 } /* end namespace mlp */
@@ -0,0 +1,312 @@
+#ifndef MLP_BLOCK_SPARSE_HPP
+#define MLP_BLOCK_SPARSE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cstdint>
+#include <cmath>
+#include <type_traits>
+#include <limits>
+
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+#include "util.hpp"
+
+namespace mlp {
+
+/**
+ * Number of consecutive columns stored per block, equal to the number of
+ * floats in an AVX register
+ */
+constexpr size_t sparse_block_size = 8;
+
+/**
+ * Pruning results
+ */
+struct prune_results {
+    /**
+     * Weights held by the dense matrix
+     */
+    size_t total_weights;
+    /**
+     * Weights still stored after pruning
+     */
+    size_t stored_weights;
+    size_t total_blocks;
+    size_t kept_blocks;
+    size_t dense_bytes;
+    size_t sparse_bytes;
+    /**
+     * Number of matrices pruned, and of those converted to block-sparse
+     * form. Matrices which would not shrink are left dense and unpruned.
+     */
+    size_t matrices;
+    size_t converted;
+
+    /**
+     * Fraction of weights removed
+     */
+    float_t sparsity() const {
+        return total_weights == 0
+            ? 0
+            : 1 - static_cast<float_t>(stored_weights) / total_weights;
+    }
+
+    /**
+     * Ratio of dense to sparse storage size
+     */
+    float_t compression() const {
+        return sparse_bytes == 0
+            ? 0
+            : static_cast<float_t>(dense_bytes) / sparse_bytes;
+    }
+
+    prune_results& operator+=(const prune_results& other) {
+        total_weights += other.total_weights;
+        stored_weights += other.stored_weights;
+        total_blocks += other.total_blocks;
+        kept_blocks += other.kept_blocks;
+        dense_bytes += other.dense_bytes;
+        sparse_bytes += other.sparse_bytes;
+        matrices += other.matrices;
+        converted += other.converted;
+        return *this;
+    }
+};
+
+/**
+ * Row-major block-sparse matrix, where each row is split into blocks of
+ * sparse_block_size columns and only the non-zero blocks are stored.
+ *
+ * Block start columns are aligned to sparse_block_size, so every block but
+ * the last of a row covers a full register width. The last block of a row is
+ * stored without padding when the row is narrower.
+ */
+struct block_sparse_matrix {
+
+    block_sparse_matrix() : rows(0), cols(0) {}
+
+    /**
+     * Construct from a dense row-major rows * cols matrix, dropping all blocks
+     * which only contain zeros
+     */
+    block_sparse_matrix(const vec_t& dense, size_t rows, size_t cols)
+        :   rows(rows),
+            cols(cols),
+            row_ptr(1, 0),
+            row_values(1, 0) {
+        if(dense.size() != rows * cols) {
+            throw mlp_error{"dense matrix does not match dimensions"};
+        }
+        if(dense.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw mlp_error{"matrix too large for block-sparse storage"};
+        }
+        row_ptr.reserve(rows + 1);
+        row_values.reserve(rows + 1);
+        for(size_t r = 0; r < rows; ++r) {
+            const float_t* row = &dense[r * cols];
+            for(size_t c = 0; c < cols; c += sparse_block_size) {
+                const size_t end = std::min(c + sparse_block_size, cols);
+                if(std::all_of(row + c, row + end, [](float_t v) { return v == 0; })) {
+                    continue;
+                }
+                block_col.push_back(static_cast<std::uint32_t>(c));
+                values.insert(values.end(), row + c, row + end);
+            }
+            row_ptr.push_back(static_cast<std::uint32_t>(block_col.size()));
+            row_values.push_back(static_cast<std::uint32_t>(values.size()));
+        }
+        block_col.shrink_to_fit();
+        values.shrink_to_fit();
+    }
+
+    /**
+     * Calculates y = A * x, where x holds cols values and y holds rows values
+     */
+    void multiply(const float_t* x, float_t* y) const {
+#ifdef __AVX__
+        static_assert(std::is_same<float_t, float>::value, "AVX kernel requires float_t to be float");
+        const size_t full_cols = cols - cols % sparse_block_size;
+        for(size_t r = 0; r < rows; ++r) {
+            __m256 acc = _mm256_setzero_ps();
+            float_t tail = 0;
+            const float_t* v = values.data() + row_values[r];
+            for(size_t b = row_ptr[r], end = row_ptr[r + 1]; b < end; ++b, v += sparse_block_size) {
+                const size_t c = block_col[b];
+                if(c < full_cols) {
+                    acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(v), _mm256_loadu_ps(x + c)));
+                } else {
+                    for(size_t i = 0; c + i < cols; ++i) {
+                        tail += v[i] * x[c + i];
+                    }
+                }
+            }
+            /**
+             * Horizontal sum of the 8 lanes
+             */
+            __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+            sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+            sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x1));
+            y[r] = _mm_cvtss_f32(sum) + tail;
+        }
+#else
+        multiply_scalar(x, y);
+#endif
+    }
+
+    /**
+     * Reference scalar implementation of multiply()
+     */
+    void multiply_scalar(const float_t* x, float_t* y) const {
+        for(size_t r = 0; r < rows; ++r) {
+            float_t total = 0;
+            const float_t* v = values.data() + row_values[r];
+            for(size_t b = row_ptr[r], end = row_ptr[r + 1]; b < end; ++b, v += sparse_block_size) {
+                const size_t c = block_col[b];
+                for(size_t i = 0; i < sparse_block_size && c + i < cols; ++i) {
+                    total += v[i] * x[c + i];
+                }
+            }
+            y[r] = total;
+        }
+    }
+
+    /**
+     * Expands the matrix back into a dense row-major rows * cols matrix
+     */
+    void to_dense(vec_t& dense) const {
+        dense.assign(rows * cols, 0);
+        for(size_t r = 0; r < rows; ++r) {
+            const float_t* v = values.data() + row_values[r];
+            for(size_t b = row_ptr[r], end = row_ptr[r + 1]; b < end; ++b, v += sparse_block_size) {
+                const size_t c = block_col[b];
+                for(size_t i = 0; i < sparse_block_size && c + i < cols; ++i) {
+                    dense[r * cols + c + i] = v[i];
+                }
+            }
+        }
+    }
+
+    /**
+     * Number of blocks stored
+     */
+    size_t blocks() const {
+        return block_col.size();
+    }
+
+    /**
+     * Number of matrix entries covered by the stored blocks
+     */
+    size_t stored() const {
+        return values.size();
+    }
+
+    /**
+     * Resident size of the matrix in bytes
+     */
+    size_t bytes() const {
+        return (row_ptr.capacity() + row_values.capacity() + block_col.capacity()) * sizeof(std::uint32_t)
+            + values.capacity() * sizeof(float_t);
+    }
+
+    bool empty() const {
+        return row_ptr.empty();
+    }
+
+    size_t rows;
+    size_t cols;
+
+    /**
+     * Index of the first block of each row, with row_ptr[rows] being the
+     * total number of blocks
+     */
+    std::vector<std::uint32_t> row_ptr;
+    /**
+     * Index of the first value of each row
+     */
+    std::vector<std::uint32_t> row_values;
+    /**
+     * Start column of each block
+     */
+    std::vector<std::uint32_t> block_col;
+    /**
+     * Values of each block, sparse_block_size per block except for a
+     * trailing partial block
+     */
+    vec_t values;
+};
+
+/**
+ * Magnitude-based block pruning of a dense row-major rows * cols matrix.
+ *
+ * Ranks every block by the sum of the absolute values of its weights and
+ * zeroes the lowest ranked fraction given by sparsity, before converting the
+ * remainder to block-sparse form. If the block-sparse form would not be
+ * smaller than the dense matrix, both are left untouched and the results
+ * report the matrix as not converted.
+ *
+ * @param dense the dense matrix, pruned in place
+ * @param sparsity the fraction of blocks to remove, in range [0, 1)
+ * @param result the resulting block-sparse matrix
+ */
+prune_results prune_blocks(  vec_t& dense,
+                             size_t rows,
+                             size_t cols,
+                             float_t sparsity,
+                             block_sparse_matrix& result) {
+    if(sparsity < 0 || sparsity >= 1) {
+        throw mlp_error{"sparsity must be in range [0, 1)"};
+    }
+    const size_t blocks_per_row = (cols + sparse_block_size - 1) / sparse_block_size;
+    const size_t total_blocks = rows * blocks_per_row;
+
+    vec_t magnitude(total_blocks, 0);
+    for(size_t r = 0; r < rows; ++r) {
+        for(size_t c = 0; c < cols; ++c) {
+            magnitude[r * blocks_per_row + c / sparse_block_size] += std::abs(dense[r * cols + c]);
+        }
+    }
+
+    std::vector<size_t> order(total_blocks);
+    std::iota(order.begin(), order.end(), 0);
+    const size_t drop = static_cast<size_t>(sparsity * total_blocks);
+    if(drop > 0) {
+        std::nth_element(order.begin(), order.begin() + (drop - 1), order.end(),
+            [&](size_t a, size_t b) { return magnitude[a] < magnitude[b]; });
+    }
+    vec_t pruned = dense;
+    for(size_t i = 0; i < drop; ++i) {
+        const size_t r = order[i] / blocks_per_row;
+        const size_t c = (order[i] % blocks_per_row) * sparse_block_size;
+        std::fill(  pruned.begin() + r * cols + c,
+                    pruned.begin() + r * cols + std::min(c + sparse_block_size, cols),
+                    0);
+    }
+
+    block_sparse_matrix sparse(pruned, rows, cols);
+    const size_t dense_bytes = dense.capacity() * sizeof(float_t);
+    if(sparse.bytes() >= dense_bytes) {
+        return {rows * cols, rows * cols, total_blocks, total_blocks, dense_bytes, dense_bytes, 1, 0};
+    }
+
+    dense.swap(pruned);
+    result = std::move(sparse);
+
+    return {
+        rows * cols,
+        result.stored(),
+        total_blocks,
+        result.blocks(),
+        dense_bytes,
+        result.bytes(),
+        1,
+        1
+    };
+}
+
+} /* end namespace mlp */
+
+#endif /* MLP_BLOCK_SPARSE_HPP */
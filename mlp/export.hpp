@@ -0,0 +1,143 @@
+#ifndef MLP_EXPORT_HPP
+#define MLP_EXPORT_HPP
+
+#include <ostream>
+#include <string>
+#include <limits>
+#include <iomanip>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+#include "util.hpp"
+
+namespace mlp {
+
+namespace detail {
+
+/**
+ * Writes a float_t as a float literal which round-trips exactly
+ */
+struct float_literal {
+    float_t value;
+};
+
+std::ostream& operator<<(std::ostream& os, const float_literal& lit) {
+    auto fl = os.flags();
+    auto prec = os.precision();
+    os << std::scientific << std::setprecision(std::numeric_limits<float>::max_digits10 - 1)
+       << static_cast<float>(lit.value) << "f";
+    os.flags(fl);
+    os.precision(prec);
+    return os;
+}
+
+/**
+ * Writes a constexpr aligned array definition, rejecting non-finite values
+ * which have no C++ literal
+ */
+void write_array(std::ostream& os, const std::string& name, const vec_t& values) {
+    if(!std::all_of(values.begin(), values.end(), [](float_t v) { return std::isfinite(v); })) {
+        throw mlp_error{"cannot export non-finite values in " + name};
+    }
+    os << "alignas(32) constexpr float " << name << "[" << values.size() << "] = {";
+    for(size_t i = 0; i < values.size(); ++i) {
+        os << (i % 4 == 0 ? "\n    " : " ") << float_literal{values[i]} << (i + 1 < values.size() ? "," : "");
+    }
+    os << "\n};\n\n";
+}
+
+} /* end namespace detail */
+
+/**
+ * Exports a trained network as a standalone C++ header, depending only on the
+ * standard library.
+ *
+ * The weights and biases are emitted as constexpr aligned arrays and the
+ * forward pass is fully unrolled for the dimensions of the network, skipping
+ * weights which are zero (e.g., after pruning). The generated header provides:
+ *
+ * - input_size and output_size constants
+ * - predict(const float* input, float* output)
+ * - classify(const float* input), returning the index of the largest output
+ *
+ * @param nn the network to export
+ * @param os the stream to write the header to
+ * @param ns the namespace to place the generated code in
+ */
+template<typename Network>
+void export_cpp(const Network& nn, std::ostream& os, const std::string& ns = "mlp_model") {
+
+    if(nn.layers.empty()) {
+        throw mlp_error{"cannot export a network without layers"};
+    }
+    if(ns.empty() || std::isdigit(static_cast<unsigned char>(ns[0])) ||
+       !std::all_of(ns.begin(), ns.end(), [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; })) {
+        throw mlp_error{"export namespace must be a valid identifier"};
+    }
+
+    std::string guard = ns + "_HPP";
+    std::transform(guard.begin(), guard.end(), guard.begin(), [](char c) {
+        return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    });
+
+    const auto& layers = nn.layers;
+
+    os << "// Generated by mlp::export_cpp, do not edit.\n"
+       << "#ifndef " << guard << "\n"
+       << "#define " << guard << "\n\n"
+       << "#include <cmath>\n"
+       << "#include <cstddef>\n\n"
+       << "namespace " << ns << " {\n\n"
+       << "constexpr std::size_t input_size = " << layers.front().input_size << ";\n"
+       << "constexpr std::size_t output_size = " << layers.back().output_size << ";\n\n";
+
+    std::vector<vec_t> weights(layers.size());
+    for(size_t l = 0; l < layers.size(); ++l) {
+        layers[l].dense_weights(weights[l]);
+        detail::write_array(os, "layer" + std::to_string(l) + "_weights", weights[l]);
+        detail::write_array(os, "layer" + std::to_string(l) + "_bias", layers[l].bias);
+    }
+
+    os << "inline float activation(float x) {\n"
+       << "    return " << Network::activation_type::source() << ";\n"
+       << "}\n\n";
+
+    os << "inline void predict(const float* input, float* output) {\n";
+    for(size_t l = 0; l < layers.size(); ++l) {
+        const auto& layer = layers[l];
+        const std::string prefix = "layer" + std::to_string(l);
+        const std::string in = l == 0 ? "input" : "out" + std::to_string(l - 1);
+        const std::string out = l + 1 == layers.size() ? "output" : "out" + std::to_string(l);
+        if(l + 1 != layers.size()) {
+            os << "    float " << out << "[" << layer.output_size << "];\n";
+        }
+        for(size_t o = 0; o < layer.output_size; ++o) {
+            os << "    " << out << "[" << o << "] = activation(" << prefix << "_bias[" << o << "]";
+            for(size_t i = 0; i < layer.input_size; ++i) {
+                const size_t w = o * layer.input_size + i;
+                if(weights[l][w] != 0) {
+                    os << "\n        + " << prefix << "_weights[" << w << "] * " << in << "[" << i << "]";
+                }
+            }
+            os << ");\n";
+        }
+    }
+    os << "}\n\n";
+
+    os << "inline std::size_t classify(const float* input) {\n"
+       << "    float output[output_size];\n"
+       << "    predict(input, output);\n"
+       << "    std::size_t best = 0;\n";
+    for(size_t o = 1; o < layers.back().output_size; ++o) {
+        os << "    if(output[" << o << "] > output[best]) best = " << o << ";\n";
+    }
+    os << "    return best;\n"
+       << "}\n\n"
+       << "} /* end namespace " << ns << " */\n\n"
+       << "#endif /* " << guard << " */\n";
+}
+
+} /* end namespace mlp */
+
+#endif /* MLP_EXPORT_HPP */
@@ -0,0 +1,506 @@
+#ifndef MLP_GRADIENT_CHECK_HPP
+#define MLP_GRADIENT_CHECK_HPP
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <limits>
+
+#include "network.hpp"
+#include "numa.hpp"
+
+namespace mlp {
+
+/**
+ * Gradient check results
+ */
+struct gradient_check_results {
+    /**
+     * Number of gradients compared
+     */
+    size_t checked;
+    float_t max_abs_error;
+    float_t max_rel_error;
+    /**
+     * True if every gradient matched within tolerance
+     */
+    bool passed;
+};
+
+/**
+ * Kernel check results, comparing an optimized kernel against the reference
+ * scalar loops
+ */
+struct kernel_check_results {
+    std::string name;
+    float_t max_error;
+    /**
+     * Best time per call in microseconds
+     */
+    double reference_us;
+    double variant_us;
+    bool passed;
+    /**
+     * True if the kernel runs the same loops as the reference, so its timing
+     * only shows the measurement noise
+     */
+    bool baseline;
+
+    double speedup() const {
+        return variant_us > 0 ? reference_us / variant_us : 0;
+    }
+};
+
+namespace detail {
+
+/**
+ * Compares an analytic and a numerical gradient, accepting an absolute
+ * error of atol plus a relative error of rtol
+ */
+void compare_gradient(  float_t analytic,
+                        float_t numeric,
+                        float_t atol,
+                        float_t rtol,
+                        gradient_check_results& res) {
+    const float_t abs_error = std::abs(analytic - numeric);
+    const float_t scale = std::max(std::abs(analytic), std::abs(numeric));
+    ++res.checked;
+    res.max_abs_error = std::max(res.max_abs_error, abs_error);
+    if(scale > 0) {
+        res.max_rel_error = std::max(res.max_rel_error, abs_error / scale);
+    }
+    if(abs_error > atol + rtol * scale) {
+        res.passed = false;
+    }
+}
+
+void randomize(vec_t& values, float_t a = -1, float_t b = 1) {
+    std::uniform_real_distribution<float_t> dist(a, b);
+    for(auto& v : values) {
+        v = dist(random_generator::get());
+    }
+}
+
+/**
+ * Largest difference between the reference and the actual values, relative
+ * to the magnitude of the reference value when above 1
+ */
+float_t max_difference(const vec_t& reference, const vec_t& actual) {
+    if(reference.size() != actual.size()) {
+        return std::numeric_limits<float_t>::infinity();
+    }
+    float_t res = 0;
+    for(size_t i = 0; i < reference.size(); ++i) {
+        const float_t scale = std::max(float_t(1), std::abs(reference[i]));
+        res = std::max(res, std::abs(reference[i] - actual[i]) / scale);
+    }
+    return res;
+}
+
+/**
+ * Time of a call to fn in microseconds, as the best of several runs which
+ * each repeat fn for at least min_us, so that fast kernels are not lost in
+ * the timer resolution
+ */
+double time_us(const std::function<void()>& fn, double min_us, size_t runs = 5) {
+    auto run = [&](size_t repeats) {
+        auto start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < repeats; ++i) {
+            fn();
+        }
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    };
+    /**
+     * Double the repeats until a run takes min_us, which also warms up the
+     * caches
+     */
+    size_t repeats = 1;
+    while(run(repeats) < min_us) {
+        repeats *= 2;
+    }
+    double best = std::numeric_limits<double>::max();
+    for(size_t i = 0; i < runs; ++i) {
+        best = std::min(best, run(repeats) / repeats);
+    }
+    return best;
+}
+
+/**
+ * Reference scalar forward propagation of an inner product layer
+ */
+template<typename Activation>
+void reference_forward( const Activation& activator,
+                        const vec_t& weights,
+                        const vec_t& bias,
+                        const vec_t& input,
+                        vec_t& output) {
+    const size_t input_size = input.size();
+    output.resize(bias.size());
+    for(size_t out = 0; out < bias.size(); ++out) {
+        float_t total = 0;
+        for(size_t in = 0; in < input_size; ++in) {
+            total += weights[out * input_size + in] * input[in];
+        }
+        output[out] = activator.f(total + bias[out]);
+    }
+}
+
+/**
+ * Reference scalar backward propagation of an inner product layer
+ */
+template<typename Activation>
+void reference_backward(const Activation& activator,
+                        const vec_t& weights,
+                        const vec_t& input,
+                        const vec_t& output,
+                        const vec_t& output_grad,
+                        vec_t& input_grad,
+                        vec_t& grad_weights,
+                        vec_t& grad_bias) {
+    const size_t input_size = input.size();
+    input_grad.assign(input_size, 0);
+    grad_weights.assign(weights.size(), 0);
+    grad_bias.assign(output.size(), 0);
+    for(size_t out = 0; out < output.size(); ++out) {
+        const auto grad = activator.df(output[out]) * output_grad[out];
+        for(size_t in = 0; in < input_size; ++in) {
+            input_grad[in] += grad * weights[out * input_size + in];
+            grad_weights[out * input_size + in] += input[in] * grad;
+        }
+        grad_bias[out] += grad;
+    }
+}
+
+} /* end namespace detail */
+
+/**
+ * Checks the gradient of a loss function against central finite differences
+ * of the loss, at random predictions and observations
+ *
+ * @param size the number of outputs
+ * @param eps the finite difference step
+ */
+template<typename LossFunction>
+gradient_check_results check_loss(  size_t size,
+                                    float_t eps = 1e-2,
+                                    float_t atol = 1e-3,
+                                    float_t rtol = 1e-2) {
+    LossFunction loss;
+    gradient_check_results res{0, 0, 0, true};
+    vec_t predicted(size), observed(size), grad(size);
+    detail::randomize(predicted, 0, 1);
+    detail::randomize(observed, 0, 1);
+    loss.df(predicted, observed, grad);
+    for(size_t i = 0; i < size; ++i) {
+        const float_t v = predicted[i];
+        predicted[i] = v + eps;
+        const float_t plus = loss.f(predicted, observed);
+        predicted[i] = v - eps;
+        const float_t minus = loss.f(predicted, observed);
+        predicted[i] = v;
+        /**
+         * Skip points within eps of a kink, e.g., of the absolute loss
+         */
+        if(std::abs(predicted[i] - observed[i]) <= eps) {
+            continue;
+        }
+        detail::compare_gradient(grad[i], (plus - minus) / (2 * eps), atol, rtol, res);
+    }
+    return res;
+}
+
+/**
+ * Checks the weight and bias gradients computed by backward propagation
+ * against central finite differences of the network's loss, for a random
+ * sample and label. Parameters whose perturbation moves an output across its
+ * observed value are skipped.
+ *
+ * @param dimensions the network dimensions
+ * @param eps the finite difference step
+ */
+template<typename Activation, typename LossFunction>
+gradient_check_results check_gradients( const std::vector<size_t>& dimensions,
+                                        float_t eps = 1e-2,
+                                        float_t atol = 1e-3,
+                                        float_t rtol = 2e-2) {
+    network<Activation, LossFunction> nn(dimensions);
+    gradient_check_results res{0, 0, 0, true};
+
+    vec_t sample(nn.input_size());
+    detail::randomize(sample, 0, 1);
+    vec_t expected, error;
+    nn.label_to_vector(random_generator::get()() % nn.output_size(), expected);
+
+    vec_t base_output;
+    bool crossed = false;
+    auto loss = [&]() {
+        nn.forward(sample);
+        /**
+         * Track outputs crossing their observed value, where losses such as
+         * the absolute loss have a kink and finite differences are invalid
+         */
+        for(size_t o = 0; o < expected.size(); ++o) {
+            crossed |= (nn.output()[o] > expected[o]) != (base_output[o] > expected[o]);
+        }
+        return nn.loss_function.f(nn.output(), expected);
+    };
+    auto check = [&](float_t& param, float_t analytic) {
+        const float_t v = param;
+        crossed = false;
+        param = v + eps;
+        const float_t plus = loss();
+        param = v - eps;
+        const float_t minus = loss();
+        param = v;
+        if(!crossed) {
+            detail::compare_gradient(analytic, (plus - minus) / (2 * eps), atol, rtol, res);
+        }
+    };
+
+    for(auto& l : nn.layers) {
+        l.clear_deltas();
+    }
+    nn.forward(sample);
+    base_output = nn.output();
+    error.resize(nn.output_size());
+    nn.gradient(nn.output(), expected, error);
+    nn.backward(error);
+
+    for(auto& l : nn.layers) {
+        for(size_t i = 0; i < l.weights.size(); ++i) {
+            check(l.weights[i], l.grad_weights[i]);
+        }
+        for(size_t i = 0; i < l.bias.size(); ++i) {
+            check(l.bias[i], l.grad_bias[i]);
+        }
+    }
+    return res;
+}
+
+/**
+ * Cross-checks every optimized kernel of an inner_product_layer of the given
+ * size against the reference scalar loops, timing both
+ *
+ * @param in the input size
+ * @param out the output size
+ * @param tolerance the maximum difference accepted, relative to the magnitude
+ * of the reference value when above 1
+ * @param min_us the minimum duration of each timed run in microseconds
+ */
+template<typename Activation>
+std::vector<kernel_check_results> check_kernels(size_t in,
+                                                size_t out,
+                                                float_t tolerance = 1e-4,
+                                                double min_us = 1000) {
+    using layer_type = inner_product_layer<Activation>;
+    const size_t batch = 16;
+    std::vector<kernel_check_results> res;
+    Activation activator;
+
+    layer_type layer(in, out);
+    detail::randomize(layer.bias);
+    samples_vec_t samples(batch, vec_t(in));
+    for(auto& s : samples) {
+        detail::randomize(s, 0, 1);
+    }
+    vec_t output_grad(out);
+    detail::randomize(output_grad);
+
+    vec_t expected, actual;
+    auto add = [&](const std::string& name, float_t max_error, double reference_us, double variant_us, bool baseline) {
+        res.push_back({name, max_error, reference_us, variant_us, max_error <= tolerance, baseline});
+    };
+
+    /**
+     * Forward propagation, per sample
+     */
+    const double forward_ref_us = detail::time_us([&]() {
+        detail::reference_forward(activator, layer.weights, layer.bias, samples[0], expected);
+    }, min_us);
+    layer.input = samples[0];
+    const double forward_us = detail::time_us([&]() {
+        layer.forward();
+    }, min_us);
+    add("forward", detail::max_difference(expected, layer.output), forward_ref_us, forward_us, true);
+
+    /**
+     * Batched forward propagation, per batch
+     */
+    vec_t batch_in, batch_expected;
+    for(const auto& s : samples) {
+        batch_in.insert(batch_in.end(), s.begin(), s.end());
+        detail::reference_forward(activator, layer.weights, layer.bias, s, expected);
+        batch_expected.insert(batch_expected.end(), expected.begin(), expected.end());
+    }
+    actual.resize(batch * out);
+    const double batch_us = detail::time_us([&]() {
+        layer.forward_batch(batch_in.data(), batch, actual.data());
+    }, min_us);
+    add("forward_batch", detail::max_difference(batch_expected, actual), forward_ref_us * batch, batch_us, false);
+
+    /**
+     * Backward propagation
+     */
+    vec_t ref_input_grad, ref_grad_weights, ref_grad_bias;
+    detail::reference_forward(activator, layer.weights, layer.bias, samples[0], expected);
+    const double backward_ref_us = detail::time_us([&]() {
+        detail::reference_backward(activator, layer.weights, samples[0], expected, output_grad,
+                                   ref_input_grad, ref_grad_weights, ref_grad_bias);
+    }, min_us);
+    layer.input = samples[0];
+    layer.forward();
+    layer.output_grad = output_grad;
+    layer.clear_deltas();
+    layer.backward();
+    auto backward_error = [&](const layer_type& l) {
+        return std::max(detail::max_difference(ref_input_grad, l.input_grad),
+                        detail::max_difference(ref_grad_bias, l.grad_bias));
+    };
+    float_t max_error = std::max(backward_error(layer), detail::max_difference(ref_grad_weights, layer.grad_weights));
+    const double backward_us = detail::time_us([&]() {
+        layer.backward();
+    }, min_us);
+    add("backward", max_error, backward_ref_us, backward_us, false);
+
+    /**
+     * Partitioned forward and backward propagation across two simulated
+     * nodes of two threads each
+     */
+    {
+        node_pool pool(numa_topology::simulated(2), 2);
+        layer_type partitioned = layer;
+        partitioned.clear_deltas();
+        partitioned.partition(pool);
+        partitioned.input = samples[0];
+        const double us = detail::time_us([&]() {
+            partitioned.forward();
+        }, min_us);
+        detail::reference_forward(activator, layer.weights, layer.bias, samples[0], expected);
+        add("partitioned forward", detail::max_difference(expected, partitioned.output), forward_ref_us, us, false);
+
+        const double batch_us = detail::time_us([&]() {
+            partitioned.forward_batch(batch_in.data(), batch, actual.data());
+        }, min_us);
+        add("partitioned forward_batch", detail::max_difference(batch_expected, actual),
+            forward_ref_us * batch, batch_us, false);
+
+        partitioned.output_grad = output_grad;
+        partitioned.backward();
+        vec_t grad_weights;
+        for(const auto& part : partitioned.partitions) {
+            grad_weights.insert(grad_weights.end(), part.grad_weights.begin(), part.grad_weights.end());
+        }
+        max_error = std::max(backward_error(partitioned), detail::max_difference(ref_grad_weights, grad_weights));
+        const double backward_us = detail::time_us([&]() {
+            partitioned.backward();
+        }, min_us);
+        add("partitioned backward", max_error, backward_ref_us, backward_us, false);
+    }
+
+    /**
+     * Block-sparse forward propagation, against the reference loops over the
+     * pruned dense weights. Layers too narrow to shrink are not converted.
+     */
+    layer_type pruned = layer;
+    if(pruned.prune(0.5).converted) {
+        vec_t weights;
+        pruned.dense_weights(weights);
+        detail::reference_forward(activator, weights, pruned.bias, samples[0], expected);
+        pruned.input = samples[0];
+        const double us = detail::time_us([&]() {
+            pruned.forward();
+        }, min_us);
+        add("sparse forward", detail::max_difference(expected, pruned.output), forward_ref_us, us, false);
+
+        vec_t sparse_expected;
+        for(const auto& s : samples) {
+            detail::reference_forward(activator, weights, pruned.bias, s, expected);
+            sparse_expected.insert(sparse_expected.end(), expected.begin(), expected.end());
+        }
+        const double batch_us = detail::time_us([&]() {
+            pruned.forward_batch(batch_in.data(), batch, actual.data());
+        }, min_us);
+        add("sparse forward_batch", detail::max_difference(sparse_expected, actual), forward_ref_us * batch, batch_us, false);
+
+        const auto& matrix = pruned.sparse_weights;
+        vec_t scalar(out), simd(out);
+        const double scalar_us = detail::time_us([&]() {
+            matrix.multiply_scalar(samples[0].data(), scalar.data());
+        }, min_us);
+        const double simd_us = detail::time_us([&]() {
+            matrix.multiply(samples[0].data(), simd.data());
+        }, min_us);
+        add("sparse multiply", detail::max_difference(scalar, simd), scalar_us, simd_us, false);
+    }
+
+    return res;
+}
+
+/**
+ * Cross-checks forward propagation of a frozen network of the given
+ * dimensions, which runs through the shared activation buffer, against the
+ * reference scalar loops, timing both
+ *
+ * @param dimensions the network dimensions
+ * @param tolerance the maximum difference accepted, relative to the magnitude
+ * of the reference value when above 1
+ * @param min_us the minimum duration of each timed run in microseconds
+ */
+template<typename Activation>
+std::vector<kernel_check_results> check_frozen(const std::vector<size_t>& dimensions,
+                                               float_t tolerance = 1e-4,
+                                               double min_us = 1000) {
+    const size_t batch = 16;
+    network<Activation> nn(dimensions);
+    for(auto& l : nn.layers) {
+        detail::randomize(l.bias);
+    }
+    samples_vec_t samples(batch, vec_t(nn.input_size()));
+    for(auto& s : samples) {
+        detail::randomize(s, 0, 1);
+    }
+
+    /**
+     * Run every sample through the reference loops before freezing, which
+     * releases the layers' vectors
+     */
+    vec_t a, b;
+    auto reference = [&](const vec_t& sample) -> const vec_t& {
+        a = sample;
+        for(const auto& l : nn.layers) {
+            detail::reference_forward(l.activator, l.weights, l.bias, a, b);
+            a.swap(b);
+        }
+        return a;
+    };
+    samples_vec_t expected;
+    for(const auto& s : samples) {
+        expected.push_back(reference(s));
+    }
+    const double reference_us = detail::time_us([&]() {
+        reference(samples[0]);
+    }, min_us);
+
+    nn.freeze();
+
+    /**
+     * Consecutive samples reuse the shared buffer, so check them all
+     */
+    float_t max_error = 0;
+    for(size_t i = 0; i < batch; ++i) {
+        nn.forward(samples[i]);
+        max_error = std::max(max_error, detail::max_difference(expected[i], nn.output()));
+    }
+    const double us = detail::time_us([&]() {
+        nn.forward(samples[0]);
+    }, min_us);
+    return {{"frozen forward", max_error, reference_us, us, max_error <= tolerance, false}};
+}
+
+} /* end namespace mlp */
+
+#endif /* MLP_GRADIENT_CHECK_HPP */
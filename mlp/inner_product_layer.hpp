@@ -9,9 +9,61 @@
 
 #include "network.hpp"
 #include "util.hpp"
+#include "block_sparse.hpp"
+#include "partition_runner.hpp"
 
 namespace mlp {
 
+/**
+ * Resident memory of a layer or network in bytes
+ */
+struct memory_usage {
+    /**
+     * Weights and biases, dense or sparse
+     */
+    size_t parameters;
+    /**
+     * Accumulated gradients and propagated gradient vectors, used for
+     * training only
+     */
+    size_t gradients;
+    /**
+     * Input and output vectors
+     */
+    size_t activations;
+
+    size_t total() const {
+        return parameters + gradients + activations;
+    }
+
+    memory_usage& operator+=(const memory_usage& other) {
+        parameters += other.parameters;
+        gradients += other.gradients;
+        activations += other.activations;
+        return *this;
+    }
+};
+
+/**
+ * Rows of a layer's weights owned by a single thread of a partition_runner
+ */
+struct layer_partition {
+    /**
+     * The first output row of the partition
+     */
+    size_t first;
+    /**
+     * The number of output rows of the partition
+     */
+    size_t rows;
+    vec_t weights;
+    vec_t grad_weights;
+    /**
+     * The partition's contribution to the layer's input gradient
+     */
+    vec_t input_grad;
+};
+
 /**
  * Inner product layer, also known as fully connected layer.
  *
@@ -62,6 +114,30 @@ public:
         if(input.size() != input_size) {
             throw mlp_error{"input vectordoes not match input size"};
         }
+        if(pruned()) {
+            sparse_weights.multiply(input.data(), output.data());
+            for(size_t out = 0; out < output_size; ++out) {
+                output[out] = activator.f(output[out] + bias[out]);
+            }
+            return;
+        }
+        if(partitioned()) {
+            /**
+             * Each thread computes the outputs of the rows it owns
+             */
+            pool->run([&](size_t p) {
+                const auto& part = partitions[p];
+                for(size_t r = 0; r < part.rows; ++r) {
+                    const float_t* w = &part.weights[r * input_size];
+                    float_t total = 0;
+                    for(size_t in = 0; in < input_size; ++in) {
+                        total += w[in] * input[in];
+                    }
+                    output[part.first + r] = activator.f(total + bias[part.first + r]);
+                }
+            });
+            return;
+        }
         for(size_t out = 0; out < output_size; ++out) {
             float_t total = 0;
             for(size_t in = 0; in < input_size; ++in) {
@@ -73,13 +149,77 @@ public:
         }
     }
 
+    /**
+     * Perform forward propagation of a batch of inputs. Unlike forward(), the
+     * layer's input and output vectors are left untouched, allowing the layer
+     * to be used concurrently.
+     *
+     * @param in batch * input_size row-major inputs
+     * @param batch the number of samples in the batch
+     * @param out batch * output_size row-major outputs
+     */
+    void forward_batch(const float_t* in, size_t batch, float_t* out) const {
+        if(pruned()) {
+            for(size_t b = 0; b < batch; ++b) {
+                sparse_weights.multiply(in + b * input_size, out + b * output_size);
+            }
+        } else if(partitioned()) {
+            pool->run([&](size_t p) {
+                const auto& part = partitions[p];
+                for(size_t r = 0; r < part.rows; ++r) {
+                    const float_t* w = &part.weights[r * input_size];
+                    for(size_t b = 0; b < batch; ++b) {
+                        const float_t* x = in + b * input_size;
+                        float_t total = 0;
+                        for(size_t i = 0; i < input_size; ++i) {
+                            total += w[i] * x[i];
+                        }
+                        out[b * output_size + part.first + r] = total;
+                    }
+                }
+            });
+        } else {
+            /**
+             * Iterate the batch for each output, so the weights of an output
+             * stay in cache across all samples
+             */
+            for(size_t o = 0; o < output_size; ++o) {
+                const float_t* w = &weights[o * input_size];
+                for(size_t b = 0; b < batch; ++b) {
+                    const float_t* x = in + b * input_size;
+                    float_t total = 0;
+                    for(size_t i = 0; i < input_size; ++i) {
+                        total += w[i] * x[i];
+                    }
+                    out[b * output_size + o] = total;
+                }
+            }
+        }
+        for(size_t b = 0; b < batch; ++b) {
+            for(size_t o = 0; o < output_size; ++o) {
+                auto& v = out[b * output_size + o];
+                v = activator.f(v + bias[o]);
+            }
+        }
+    }
+
     /**
      * Perform backward propagation
      */
     void backward() {
+        if(frozen()) {
+            throw mlp_error{"frozen layer does not support training"};
+        }
         if(output_grad.size() != output_size) {
             throw mlp_error{"output gradient vector does not match output size"};
         }
+        if(pruned()) {
+            throw mlp_error{"pruned layer does not support training"};
+        }
+        if(partitioned()) {
+            backward_partitioned();
+            return;
+        }
         std::fill(input_grad.begin(), input_grad.end(), 0);
         for(size_t out = 0; out < output_size; ++out) {
             /**
@@ -119,6 +259,26 @@ public:
      * @param alpha the learning rate to apply
      */
     void update_weights(const float_t& alpha) {
+        if(frozen()) {
+            throw mlp_error{"frozen layer does not support training"};
+        }
+        if(pruned()) {
+            throw mlp_error{"pruned layer does not support training"};
+        }
+        if(partitioned()) {
+            pool->run([&](size_t p) {
+                auto& part = partitions[p];
+                for(size_t i = 0, len = part.weights.size(); i < len; ++i) {
+                    part.weights[i] -= alpha * part.grad_weights[i];
+                }
+                std::fill(part.grad_weights.begin(), part.grad_weights.end(), 0.0f);
+            });
+            for(size_t i = 0; i < bias.size(); ++i) {
+                bias[i] -= alpha * grad_bias[i];
+            }
+            std::fill(grad_bias.begin(), grad_bias.end(), 0.0f);
+            return;
+        }
         for(size_t i = 0; i < input_size * output_size; ++i) {
             weights[i] -= alpha * grad_weights[i];
         }
@@ -135,6 +295,140 @@ public:
     void clear_deltas() {
         std::fill(grad_weights.begin(), grad_weights.end(), 0.0f);
         std::fill(grad_bias.begin(), grad_bias.end(), 0.0f);
+        for(auto& part : partitions) {
+            std::fill(part.grad_weights.begin(), part.grad_weights.end(), 0.0f);
+        }
+    }
+
+    /**
+     * Partition the weights by output rows across the threads of the runner.
+     * Each thread allocates and first touches its own rows, which with a
+     * node_pool places them in the memory of the thread's NUMA node, and
+     * forward and backward propagation then compute every thread's rows on
+     * that thread. The runner must outlive the layer.
+     *
+     * @param runner the runner to partition across, e.g., a node_pool
+     */
+    void partition(partition_runner& runner) {
+        if(pruned() || frozen()) {
+            throw mlp_error{"cannot partition a pruned or frozen layer"};
+        }
+        if(partitioned()) {
+            throw mlp_error{"layer is already partitioned"};
+        }
+        partitions.resize(runner.size());
+        for(size_t n = 0; n < runner.size(); ++n) {
+            partitions[n].first = n * output_size / runner.size();
+            partitions[n].rows = (n + 1) * output_size / runner.size() - partitions[n].first;
+        }
+        runner.run([&](size_t p) {
+            auto& part = partitions[p];
+            const auto begin = part.first * input_size;
+            const auto end = (part.first + part.rows) * input_size;
+            part.weights.assign(weights.begin() + begin, weights.begin() + end);
+            part.grad_weights.assign(grad_weights.begin() + begin, grad_weights.begin() + end);
+            part.input_grad.assign(input_size, 0);
+        });
+        vec_t().swap(weights);
+        vec_t().swap(grad_weights);
+        pool = &runner;
+    }
+
+    /**
+     * Returns true if the weights are partitioned across threads
+     */
+    bool partitioned() const {
+        return !partitions.empty();
+    }
+
+    /**
+     * Copies the weights into a dense row-major output_size * input_size
+     * vector, regardless of how they are stored
+     */
+    void dense_weights(vec_t& result) const {
+        if(pruned()) {
+            sparse_weights.to_dense(result);
+        } else if(partitioned()) {
+            result.clear();
+            for(const auto& part : partitions) {
+                result.insert(result.end(), part.weights.begin(), part.weights.end());
+            }
+        } else {
+            result = weights;
+        }
+    }
+
+    /**
+     * Prune the weights by magnitude and convert the layer to block-sparse
+     * storage. The dense weights and their gradients are released, leaving
+     * the layer usable for inference only. Layers for which block-sparse
+     * storage would not be smaller are left unchanged, see prune_blocks.
+     *
+     * @param sparsity the fraction of weight blocks to remove, in range [0, 1)
+     */
+    prune_results prune(const float_t& sparsity) {
+        if(pruned()) {
+            throw mlp_error{"layer is already pruned"};
+        }
+        if(partitioned()) {
+            throw mlp_error{"cannot prune a partitioned layer"};
+        }
+        auto res = prune_blocks(weights, output_size, input_size, sparsity, sparse_weights);
+        if(res.converted) {
+            vec_t().swap(weights);
+            vec_t().swap(grad_weights);
+        }
+        return res;
+    }
+
+    /**
+     * Returns true if the layer holds block-sparse weights
+     */
+    bool pruned() const {
+        return !sparse_weights.empty();
+    }
+
+    /**
+     * Freeze the layer for inference, releasing all gradient state along
+     * with the input and output vectors. A frozen layer can only be used
+     * through forward_batch(), with the caller providing the activations.
+     */
+    void freeze() {
+        vec_t().swap(input);
+        vec_t().swap(output);
+        vec_t().swap(input_grad);
+        vec_t().swap(output_grad);
+        vec_t().swap(grad_weights);
+        vec_t().swap(grad_bias);
+        for(auto& part : partitions) {
+            vec_t().swap(part.grad_weights);
+            vec_t().swap(part.input_grad);
+        }
+    }
+
+    /**
+     * Returns true if the layer has been frozen, i.e., its gradients have
+     * been released
+     */
+    bool frozen() const {
+        return grad_bias.empty();
+    }
+
+    /**
+     * Returns the resident memory of the layer
+     */
+    memory_usage memory() const {
+        memory_usage res{
+            (weights.capacity() + bias.capacity()) * sizeof(float_t) + sparse_weights.bytes(),
+            (input_grad.capacity() + output_grad.capacity() + grad_weights.capacity()
+                + grad_bias.capacity()) * sizeof(float_t),
+            (input.capacity() + output.capacity()) * sizeof(float_t)
+        };
+        for(const auto& part : partitions) {
+            res.parameters += part.weights.capacity() * sizeof(float_t);
+            res.gradients += (part.grad_weights.capacity() + part.input_grad.capacity()) * sizeof(float_t);
+        }
+        return res;
     }
 
     activation_type activator;
@@ -145,6 +439,19 @@ public:
      * The weight of each input/output pair
      */
     vec_t weights;
+    /**
+     * The pruned weights, replacing weights once the layer has been pruned
+     */
+    block_sparse_matrix sparse_weights;
+    /**
+     * The weights partitioned across threads, replacing weights once the
+     * layer has been partitioned
+     */
+    std::vector<layer_partition> partitions;
+    /**
+     * The runner of the partitions, if partitioned
+     */
+    partition_runner* pool = nullptr;
     /**
      * The bias term for each output
      */
@@ -175,6 +482,35 @@ public:
      * Accumulated gradient error of bias
      */
     vec_t grad_bias;
+
+private:
+
+    /**
+     * Backward propagation of a partitioned layer, where each thread
+     * accumulates the gradients of its rows and its share of the input
+     * gradient, which are then summed
+     */
+    void backward_partitioned() {
+        pool->run([&](size_t p) {
+            auto& part = partitions[p];
+            std::fill(part.input_grad.begin(), part.input_grad.end(), 0);
+            for(size_t r = 0; r < part.rows; ++r) {
+                const size_t out = part.first + r;
+                const auto grad = activator.df(output[out]) * output_grad[out];
+                for(size_t in = 0; in < input_size; ++in) {
+                    part.input_grad[in] += grad * part.weights[r * input_size + in];
+                    part.grad_weights[r * input_size + in] += input[in] * grad;
+                }
+                grad_bias[out] += grad;
+            }
+        });
+        std::fill(input_grad.begin(), input_grad.end(), 0);
+        for(const auto& part : partitions) {
+            for(size_t in = 0; in < input_size; ++in) {
+                input_grad[in] += part.input_grad[in];
+            }
+        }
+    }
 };
 
 } /* end namespace mlp */
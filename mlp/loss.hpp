@@ -7,8 +7,8 @@
 namespace mlp {
 
 /**
- * Error of loss function
- *
+ * Error of loss function, half the sum of squared errors, whose gradient is
+ * the error itself
  */
 struct error_loss {
 
@@ -24,9 +24,9 @@ struct error_loss {
                 const vec_t& observed) {
         float_t sum = 0;
         for(size_t i = 0, len = predicted.size(); i < len; ++i) {
-            sum += std::abs(predicted[i] - observed[i]);
+            sum += (predicted[i] - observed[i]) * (predicted[i] - observed[i]);
         }
-        return sum;
+        return sum / 2;
     }
 };
 
@@ -57,7 +57,7 @@ struct absolute_loss {
         for(size_t i = 0, len = predictions.size(); i < len; ++i) {
             sum += std::abs(predictions[i] - observed[i]);
         }
-        return sum;
+        return sum / predictions.size();
     }
 };
 
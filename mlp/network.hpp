@@ -7,6 +7,8 @@
 #include <random>
 #include <iterator>
 #include <limits>
+#include <istream>
+#include <ostream>
 #include "util.hpp"
 #include "loss.hpp"
 #include "activation.hpp"
@@ -128,6 +130,14 @@ struct network {
      * @param input
      */
     void forward(const vec_t& in) {
+        if(frozen()) {
+            /**
+             * Frozen layers hold no activations, so run the input through
+             * the shared activation buffer into the output layer's output
+             */
+            forward_batch(in, 1, output(), activations);
+            return;
+        }
         /**
          * Copy the provided input into the input layer's input
          */
@@ -147,6 +157,38 @@ struct network {
         }
     }
 
+    /**
+     * Perform forward propagation of a batch of samples. The network is not
+     * modified, so concurrent batches may be run on a shared network.
+     *
+     * @param in batch * input_size() row-major samples
+     * @param batch the number of samples
+     * @param out receives batch * output_size() row-major outputs
+     * @param scratch buffer for intermediate activations, reusable between calls
+     */
+    void forward_batch(const vec_t& in, size_t batch, vec_t& out, vec_t& scratch) const {
+        if(in.size() != batch * layers.front().input_size) {
+            throw mlp_error{"batch does not match input size"};
+        }
+        size_t width = 0;
+        for(const auto& l : layers) {
+            width = std::max(width, l.output_size);
+        }
+        out.resize(batch * width);
+        scratch.resize(batch * width);
+        /**
+         * Alternate between out and scratch, such that the last layer writes
+         * into out
+         */
+        const float_t* src = in.data();
+        for(size_t l = 0, len = layers.size(); l < len; ++l) {
+            float_t* dst = (len - 1 - l) % 2 == 0 ? out.data() : scratch.data();
+            layers[l].forward_batch(src, batch, dst);
+            src = dst;
+        }
+        out.resize(batch * layers.back().output_size);
+    }
+
     /**
      * Perform backward propagation of the MLP network
      * @param error
@@ -208,6 +250,73 @@ struct network {
         }
     }
 
+    /**
+     * Partition the weights of every layer with at least min_weights weights
+     * by output rows across the threads of the runner, see
+     * inner_product_layer::partition. The runner must outlive the network.
+     */
+    void partition(partition_runner& runner, size_t min_weights = partition_min_weights) {
+        for(auto& l : layers) {
+            if(l.input_size * l.output_size >= min_weights) {
+                l.partition(runner);
+            }
+        }
+    }
+
+    /**
+     * Freeze the network for inference, releasing the gradients and
+     * activation vectors of every layer. Forward propagation then shares a
+     * single activation buffer across all layers, and training is no longer
+     * supported.
+     */
+    void freeze() {
+        size_t width = 0;
+        for(auto& l : layers) {
+            l.freeze();
+            width = std::max(width, l.output_size);
+        }
+        /**
+         * Size the buffers forward() alternates between up front, so that
+         * memory() is accurate before the first forward pass
+         */
+        activations.resize(width);
+        output().reserve(width);
+        output().resize(layers.back().output_size);
+    }
+
+    /**
+     * Returns true if the network has been frozen
+     */
+    bool frozen() const {
+        return layers.front().frozen();
+    }
+
+    /**
+     * Returns the resident memory of the network
+     */
+    memory_usage memory() const {
+        memory_usage res{0, 0, activations.capacity() * sizeof(float_t)};
+        for(const auto& l : layers) {
+            res += l.memory();
+        }
+        return res;
+    }
+
+    /**
+     * Prune the weights of every layer, converting the network to block-sparse
+     * storage for inference
+     *
+     * @param sparsity the fraction of weight blocks to remove, in range [0, 1)
+     * @return the combined pruning results of all layers
+     */
+    prune_results prune(const float_t& sparsity) {
+        prune_results res{};
+        for(auto& l : layers) {
+            res += l.prune(sparsity);
+        }
+        return res;
+    }
+
     /**
      * Calculate the loss of the samples given the labels
      * @return the accumulated loss of the dataset provided
@@ -231,6 +340,79 @@ struct network {
         return loss(samples, labels) / samples.size();
     }
 
+    /**
+     * Save the dimensions, weights and biases of the network, pruned and
+     * partitioned layers being saved as dense
+     */
+    void save(std::ostream& os) const {
+        os << layers.size() + 1 << "\n" << layers.front().input_size;
+        for(const auto& l : layers) {
+            os << " " << l.output_size;
+        }
+        os << "\n";
+        auto prec = os.precision(std::numeric_limits<float_t>::max_digits10);
+        vec_t weights;
+        for(const auto& l : layers) {
+            l.dense_weights(weights);
+            for(auto w : weights) {
+                os << w << " ";
+            }
+            os << "\n";
+            for(auto b : l.bias) {
+                os << b << " ";
+            }
+            os << "\n";
+        }
+        os.precision(prec);
+        if(!os) {
+            throw mlp_error{"failed to save network"};
+        }
+    }
+
+    /**
+     * Load a network previously stored with save()
+     */
+    static network load(std::istream& is) {
+        /**
+         * Bound the dimensions before allocating, so corrupt files are
+         * reported rather than exhausting memory
+         */
+        const size_t max_layers = 1024;
+        const size_t max_parameters = size_t(1) << 30;
+        size_t count = 0;
+        if(!(is >> count) || count < 2 || count > max_layers + 1) {
+            throw mlp_error{"invalid network dimensions"};
+        }
+        std::vector<size_t> dimensions(count);
+        size_t parameters = 0;
+        for(size_t i = 0; i < count; ++i) {
+            long long d = 0;
+            if(!(is >> d) || d <= 0 || static_cast<unsigned long long>(d) > max_parameters) {
+                throw mlp_error{"invalid network dimensions"};
+            }
+            dimensions[i] = static_cast<size_t>(d);
+            if(i > 0) {
+                parameters += (dimensions[i - 1] + 1) * dimensions[i];
+                if(parameters > max_parameters) {
+                    throw mlp_error{"network too large to load"};
+                }
+            }
+        }
+        network nn(dimensions);
+        for(auto& l : nn.layers) {
+            for(auto& w : l.weights) {
+                is >> w;
+            }
+            for(auto& b : l.bias) {
+                is >> b;
+            }
+        }
+        if(!is) {
+            throw mlp_error{"invalid network weights"};
+        }
+        return nn;
+    }
+
     /**
      * The input size of the network
      */
@@ -278,6 +460,10 @@ struct network {
 
     std::vector<layer_type> layers;
 
+    /**
+     * Activation buffer shared by all layers once the network is frozen
+     */
+    vec_t activations;
 
     loss_function_type loss_function;
     /**
@@ -0,0 +1,285 @@
+#ifndef MLP_NUMA_HPP
+#define MLP_NUMA_HPP
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#endif
+
+#include "util.hpp"
+#include "partition_runner.hpp"
+
+namespace mlp {
+
+/**
+ * NUMA topology, as the CPUs belonging to each node
+ */
+struct numa_topology {
+
+    /**
+     * Detects the topology from /sys/devices/system/node on Linux, falling
+     * back to a single node holding all available CPUs. Node IDs may be
+     * sparse, and nodes without CPUs, e.g., memory-only nodes, are skipped as
+     * no thread can be pinned to them.
+     */
+    static numa_topology detect() {
+        numa_topology res;
+#ifdef __linux__
+        const std::string root = "/sys/devices/system/node/";
+        std::vector<int> ids;
+        if(DIR* dir = ::opendir(root.c_str())) {
+            while(dirent* entry = ::readdir(dir)) {
+                const std::string name = entry->d_name;
+                if(name.size() > 4 && name.compare(0, 4, "node") == 0
+                        && name.find_first_not_of("0123456789", 4) == std::string::npos) {
+                    ids.push_back(std::stoi(name.substr(4)));
+                }
+            }
+            ::closedir(dir);
+        }
+        std::sort(ids.begin(), ids.end());
+        for(auto id : ids) {
+            std::ifstream file(root + "node" + std::to_string(id) + "/cpulist");
+            std::string list;
+            std::getline(file, list);
+            std::vector<int> cpus;
+            for(auto cpu : parse_cpulist(list)) {
+                if(cpu >= 0 && cpu < CPU_SETSIZE) {
+                    cpus.push_back(cpu);
+                }
+            }
+            if(!cpus.empty()) {
+                res.nodes.push_back(std::move(cpus));
+            }
+        }
+#endif
+        if(res.nodes.empty()) {
+            res.nodes.push_back(available_cpus());
+        }
+        return res;
+    }
+
+    /**
+     * Simulates node_count nodes by dividing the available CPUs between them,
+     * with nodes sharing CPUs when there are fewer CPUs than nodes
+     */
+    static numa_topology simulated(size_t node_count) {
+        if(node_count == 0) {
+            throw mlp_error{"node count must be greater than 0"};
+        }
+        auto cpus = available_cpus();
+        numa_topology res;
+        res.nodes.resize(node_count);
+        for(size_t n = 0; n < node_count; ++n) {
+            const size_t first = n * cpus.size() / node_count;
+            const size_t last = std::max(first + 1, (n + 1) * cpus.size() / node_count);
+            for(size_t c = first; c < last; ++c) {
+                res.nodes[n].push_back(cpus[c % cpus.size()]);
+            }
+        }
+        return res;
+    }
+
+    size_t size() const {
+        return nodes.size();
+    }
+
+    /**
+     * The CPUs of each node
+     */
+    std::vector<std::vector<int>> nodes;
+
+private:
+
+    /**
+     * Parses a CPU list such as "0-3,8-11"
+     */
+    static std::vector<int> parse_cpulist(const std::string& list) {
+        std::vector<int> cpus;
+        std::stringstream iss(list);
+        std::string range;
+        while(std::getline(iss, range, ',')) {
+            if(range.empty()) {
+                continue;
+            }
+            auto dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            /**
+             * Bound malformed ranges, no kernel supports as many CPUs
+             */
+            last = std::min(last, 1 << 16);
+            for(int c = first; c <= last; ++c) {
+                cpus.push_back(c);
+            }
+        }
+        return cpus;
+    }
+
+    /**
+     * Returns the CPUs the process may run on, or all CPUs where the
+     * affinity cannot be queried
+     */
+    static std::vector<int> available_cpus() {
+        std::vector<int> cpus;
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if(sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for(int c = 0; c < CPU_SETSIZE; ++c) {
+                if(CPU_ISSET(c, &set)) {
+                    cpus.push_back(c);
+                }
+            }
+        }
+#else
+        for(unsigned c = 0; c < std::thread::hardware_concurrency(); ++c) {
+            cpus.push_back(static_cast<int>(c));
+        }
+#endif
+        if(cpus.empty()) {
+            cpus.push_back(0);
+        }
+        return cpus;
+    }
+};
+
+/**
+ * Pool of threads_per_node threads per NUMA node, each pinned to the CPUs of
+ * its node. Thread t runs partition t and belongs to node t / threads_per_node.
+ *
+ * Memory allocated and first written by a node's thread is placed on that
+ * node by the kernel's first-touch policy, which the partitioned layers rely
+ * on to keep their weights local to the threads using them. Threads are only
+ * pinned on Linux, elsewhere the pool runs unpinned threads.
+ */
+class node_pool : public partition_runner {
+public:
+
+    explicit node_pool(numa_topology topology, size_t threads_per_node = 1)
+        :   topology(std::move(topology)),
+            threads_per_node(threads_per_node),
+            generation(0),
+            remaining(0),
+            stopping(false) {
+        if(this->topology.size() == 0 || threads_per_node == 0) {
+            throw mlp_error{"topology must have at least one node and one thread per node"};
+        }
+        for(size_t t = 0; t < this->topology.size() * threads_per_node; ++t) {
+            threads.emplace_back(&node_pool::work, this, t);
+        }
+    }
+
+    ~node_pool() {
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            stopping = true;
+        }
+        started.notify_all();
+        for(auto& t : threads) {
+            t.join();
+        }
+    }
+
+    node_pool(const node_pool&) = delete;
+    node_pool& operator=(const node_pool&) = delete;
+
+    /**
+     * Runs task(thread) on every thread of the pool, returning once all have
+     * finished. Concurrent calls are run one after another.
+     */
+    void run(const std::function<void(size_t)>& task) override {
+        std::lock_guard<std::mutex> serial(run_mutex);
+        std::unique_lock<std::mutex> lk(mutex);
+        current = &task;
+        error = nullptr;
+        remaining = threads.size();
+        ++generation;
+        started.notify_all();
+        finished.wait(lk, [&] { return remaining == 0; });
+        current = nullptr;
+        if(error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    size_t size() const override {
+        return threads.size();
+    }
+
+    const numa_topology topology;
+    const size_t threads_per_node;
+
+private:
+
+    void work(size_t thread) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for(auto cpu : topology.nodes[thread / threads_per_node]) {
+            if(cpu >= 0 && cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        /**
+         * Pinning is best effort, e.g., the CPUs may be outside of the
+         * process' allowed set
+         */
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+
+        size_t seen = 0;
+        for(;;) {
+            const std::function<void(size_t)>* task;
+            {
+                std::unique_lock<std::mutex> lk(mutex);
+                started.wait(lk, [&] { return stopping || generation != seen; });
+                if(stopping) {
+                    return;
+                }
+                seen = generation;
+                task = current;
+            }
+            std::exception_ptr err;
+            try {
+                (*task)(thread);
+            } catch(...) {
+                err = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lk(mutex);
+            if(err && !error) {
+                error = err;
+            }
+            if(--remaining == 0) {
+                finished.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex run_mutex;
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    const std::function<void(size_t)>* current = nullptr;
+    std::exception_ptr error;
+    size_t generation;
+    size_t remaining;
+    bool stopping;
+};
+
+} /* end namespace mlp */
+
+#endif /* MLP_NUMA_HPP */
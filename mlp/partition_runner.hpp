@@ -0,0 +1,40 @@
+#ifndef MLP_PARTITION_RUNNER_HPP
+#define MLP_PARTITION_RUNNER_HPP
+
+#include <functional>
+
+#include "util.hpp"
+
+namespace mlp {
+
+/**
+ * Minimum number of weights for network::partition to partition a layer by
+ * default, sized to a typical 256 KiB L2 cache. Smaller layers are faster to
+ * compute on the calling thread than to fan out across threads.
+ */
+constexpr size_t partition_min_weights = 256 * 1024 / sizeof(float_t);
+
+/**
+ * Runs the partitions of a layer, each on its own thread, see
+ * inner_product_layer::partition and node_pool (mlp/numa.hpp)
+ */
+class partition_runner {
+public:
+
+    virtual ~partition_runner() {}
+
+    /**
+     * Returns the number of partitions
+     */
+    virtual size_t size() const = 0;
+
+    /**
+     * Runs task(partition) for every partition, returning once all have
+     * finished. The same partition must always run on the same thread.
+     */
+    virtual void run(const std::function<void(size_t)>& task) = 0;
+};
+
+} /* end namespace mlp */
+
+#endif /* MLP_PARTITION_RUNNER_HPP */
@@ -0,0 +1,713 @@
+#ifndef MLP_SERVER_HPP
+#define MLP_SERVER_HPP
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include "util.hpp"
+
+namespace mlp {
+
+namespace detail {
+
+/**
+ * Removes a stale unix socket left behind by a server which did not shut down
+ * cleanly, refusing to remove anything that is not a socket or a socket which
+ * another server is still listening on
+ */
+void remove_stale_socket(const sockaddr_un& addr) {
+    struct stat st;
+    if(::lstat(addr.sun_path, &st) != 0) {
+        return;
+    }
+    if(!S_ISSOCK(st.st_mode)) {
+        throw mlp_error{"refusing to replace " + std::string(addr.sun_path) + ", which is not a socket"};
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0) {
+        throw mlp_error{"failed to open socket: " + std::string(std::strerror(errno))};
+    }
+    const bool live = ::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0;
+    ::close(fd);
+    if(live) {
+        throw mlp_error{std::string(addr.sun_path) + " is in use by another server"};
+    }
+    ::unlink(addr.sun_path);
+}
+
+/**
+ * Opens a socket for the address given as either "unix:<path>" or
+ * "tcp:<port>" (localhost only), either listening on or connected to it
+ */
+int open_socket(const std::string& address, bool listening) {
+    int fd = -1;
+    int res = -1;
+    if(address.compare(0, 5, "unix:") == 0) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        const std::string path = address.substr(5);
+        if(path.empty() || path.size() >= sizeof(addr.sun_path)) {
+            throw mlp_error{"invalid unix socket path: " + path};
+        }
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        if(listening) {
+            remove_stale_socket(addr);
+        }
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if(fd >= 0) {
+            if(listening) {
+                res = ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+            } else {
+                res = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+            }
+        }
+    } else if(address.compare(0, 4, "tcp:") == 0) {
+        const char* port = address.c_str() + 4;
+        char* end = nullptr;
+        errno = 0;
+        const unsigned long value = std::strtoul(port, &end, 10);
+        if(end == port || *end != '\0' || errno == ERANGE || *port == '-' || value == 0 || value > 65535) {
+            throw mlp_error{"invalid tcp port: " + std::string(port)};
+        }
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<std::uint16_t>(value));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if(fd >= 0) {
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            if(listening) {
+                ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+                res = ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+            } else {
+                res = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+            }
+        }
+    } else {
+        throw mlp_error{"address must be unix:<path> or tcp:<port>"};
+    }
+    if(res == 0 && listening) {
+        res = ::listen(fd, SOMAXCONN);
+    }
+    if(res != 0) {
+        std::string why = std::strerror(errno);
+        if(fd >= 0) {
+            ::close(fd);
+        }
+        throw mlp_error{"failed to open " + address + ": " + why};
+    }
+    return fd;
+}
+
+/**
+ * Buffered line reader and writer over a socket
+ */
+struct line_stream {
+
+    /**
+     * @param max_line the maximum length of a line, bounding the buffer
+     */
+    explicit line_stream(int fd, size_t max_line = 1 << 20)
+        :   fd(fd), pos(0), max_line(max_line), overflowed(false) {}
+
+    /**
+     * Reads the next line, without the newline
+     * @return false once the connection is closed or a line exceeds
+     * max_line, setting overflowed
+     */
+    bool read_line(std::string& line) {
+        for(;;) {
+            auto nl = buffer.find('\n', pos);
+            if(nl != std::string::npos) {
+                line.assign(buffer, pos, nl - pos);
+                pos = nl + 1;
+                return true;
+            }
+            buffer.erase(0, pos);
+            pos = 0;
+            if(buffer.size() > max_line) {
+                overflowed = true;
+                return false;
+            }
+            char chunk[4096];
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if(n <= 0) {
+                return false;
+            }
+            buffer.append(chunk, static_cast<size_t>(n));
+        }
+    }
+
+    bool write(const std::string& data) {
+        size_t sent = 0;
+        while(sent < data.size()) {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if(n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    int fd;
+    std::string buffer;
+    size_t pos;
+    size_t max_line;
+    bool overflowed;
+};
+
+} /* end namespace detail */
+
+/**
+ * Inference server options
+ */
+struct server_options {
+    /**
+     * Address to listen on, "unix:<path>" or "tcp:<port>"
+     */
+    std::string address = "unix:/tmp/mlp.sock";
+    /**
+     * Maximum number of requests per batch
+     */
+    size_t max_batch = 32;
+    /**
+     * Maximum time the oldest request waits for a batch to fill up
+     */
+    std::chrono::microseconds latency_budget{500};
+    /**
+     * Number of threads running batches
+     */
+    size_t workers = 2;
+};
+
+/**
+ * Snapshot of the server metrics
+ */
+struct server_stats {
+    size_t queue_depth;
+    size_t requests;
+    size_t batches;
+    float_t mean_batch;
+    /**
+     * Latency percentiles from arrival to completion in microseconds, as the
+     * upper bound of their power of two histogram bucket
+     */
+    size_t p50_us;
+    size_t p99_us;
+    size_t max_us;
+
+    std::string to_string() const {
+        std::ostringstream os;
+        os << "queue_depth=" << queue_depth
+           << " requests=" << requests
+           << " batches=" << batches
+           << " mean_batch=" << mean_batch
+           << " p50_us=" << p50_us
+           << " p99_us=" << p99_us
+           << " max_us=" << max_us;
+        return os.str();
+    }
+};
+
+/**
+ * Local inference server, answering requests over a unix domain socket or
+ * localhost TCP.
+ *
+ * Concurrent requests are coalesced into micro-batches of up to max_batch
+ * requests, waiting at most latency_budget for a batch to fill, and run
+ * through network::forward_batch on a pool of worker threads.
+ *
+ * The protocol is line based. A request is a line of comma separated
+ * features, answered with the predicted label followed by the outputs:
+ *
+ *     0.2,0.5,0.1,0.3
+ *     0 0.93 0.06 0.0001
+ *
+ * The line "stats" is answered with the current server_stats, and invalid
+ * requests with a line starting with "error".
+ *
+ * @tparam Network the network type served
+ */
+template<typename Network>
+class inference_server {
+public:
+
+    using clock = std::chrono::steady_clock;
+
+    inference_server(Network nn, server_options opts)
+        :   nn(std::move(nn)),
+            opts(std::move(opts)),
+            listen_fd(-1),
+            stopping(false),
+            pending(0),
+            requests(0),
+            batches(0),
+            max_latency(0) {
+        if(this->opts.max_batch == 0 || this->opts.workers == 0) {
+            throw mlp_error{"max_batch and workers must be greater than 0"};
+        }
+        for(auto& bucket : histogram) {
+            bucket = 0;
+        }
+    }
+
+    ~inference_server() {
+        stop();
+    }
+
+    /**
+     * Start listening and serving requests in the background
+     */
+    void start() {
+        listen_fd = detail::open_socket(opts.address, true);
+        stopping = false;
+        threads.emplace_back(&inference_server::dispatch, this);
+        for(size_t i = 0; i < opts.workers; ++i) {
+            threads.emplace_back(&inference_server::work, this);
+        }
+        threads.emplace_back(&inference_server::accept, this);
+    }
+
+    /**
+     * Stop serving, closing all connections and waiting for all threads
+     */
+    void stop() {
+        if(listen_fd < 0) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            stopping = true;
+            ::shutdown(listen_fd, SHUT_RDWR);
+            for(auto fd : connections) {
+                ::shutdown(fd, SHUT_RDWR);
+            }
+        }
+        queued.notify_all();
+        batch_queued.notify_all();
+        for(auto& t : threads) {
+            t.join();
+        }
+        threads.clear();
+        /**
+         * No connections are accepted once the accept thread has finished
+         */
+        std::vector<std::thread> serving;
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            serving.swap(connection_threads);
+        }
+        for(auto& t : serving) {
+            t.join();
+        }
+        finished.clear();
+        ::close(listen_fd);
+        listen_fd = -1;
+        if(opts.address.compare(0, 5, "unix:") == 0) {
+            ::unlink(opts.address.c_str() + 5);
+        }
+    }
+
+    /**
+     * Returns a snapshot of the server metrics
+     */
+    server_stats stats() const {
+        server_stats s{};
+        s.queue_depth = pending;
+        s.requests = requests;
+        s.batches = batches;
+        s.mean_batch = s.batches == 0 ? 0 : static_cast<float_t>(s.requests) / s.batches;
+        s.max_us = max_latency;
+
+        size_t counts[buckets];
+        size_t total = 0;
+        for(size_t i = 0; i < buckets; ++i) {
+            counts[i] = histogram[i];
+            total += counts[i];
+        }
+        size_t seen = 0;
+        for(size_t i = 0; i < buckets; ++i) {
+            seen += counts[i];
+            if(s.p50_us == 0 && seen * 2 >= total && total > 0) {
+                s.p50_us = size_t(1) << i;
+            }
+            if(s.p99_us == 0 && seen * 100 >= total * 99 && total > 0) {
+                s.p99_us = size_t(1) << i;
+            }
+        }
+        return s;
+    }
+
+private:
+
+    /**
+     * A pending request, owned by its connection thread
+     */
+    struct request {
+        vec_t input;
+        vec_t output;
+        clock::time_point arrived;
+        std::promise<void> done;
+    };
+
+    using batch = std::vector<request*>;
+
+    /**
+     * Accepts connections, serving each on its own thread
+     */
+    void accept() {
+        for(;;) {
+            int fd = ::accept(listen_fd, nullptr, nullptr);
+            const int err = errno;
+            reap();
+            {
+                std::lock_guard<std::mutex> lk(mutex);
+                if(stopping) {
+                    if(fd >= 0) {
+                        ::close(fd);
+                    }
+                    return;
+                }
+                if(fd >= 0) {
+                    connections.push_back(fd);
+                    connection_threads.emplace_back(&inference_server::serve, this, fd);
+                    continue;
+                }
+            }
+            /**
+             * Out of descriptors or memory, which persists until connections
+             * are closed, so back off rather than spinning
+             */
+            if(err == EMFILE || err == ENFILE || err == ENOBUFS || err == ENOMEM) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        }
+    }
+
+    /**
+     * Joins the threads of closed connections, so they do not accumulate
+     * until the server is stopped
+     */
+    void reap() {
+        std::vector<std::thread> closed;
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            for(auto id : finished) {
+                auto it = std::find_if(connection_threads.begin(), connection_threads.end(),
+                    [&](const std::thread& t) { return t.get_id() == id; });
+                closed.push_back(std::move(*it));
+                connection_threads.erase(it);
+            }
+            finished.clear();
+        }
+        for(auto& t : closed) {
+            t.join();
+        }
+    }
+
+    /**
+     * Serves the requests of a connection until it is closed
+     */
+    void serve(int fd) {
+        const size_t input_size = nn.layers.front().input_size;
+        /**
+         * Bound the line length by the features, allowing far more digits
+         * per feature than a float needs
+         */
+        detail::line_stream stream(fd, 64 * (input_size + 1));
+        std::string line;
+        while(stream.read_line(line)) {
+            if(!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if(line == "stats") {
+                if(!stream.write(stats().to_string() + "\n")) {
+                    break;
+                }
+                continue;
+            }
+
+            request req;
+            if(!parse(line, req.input) || req.input.size() != input_size) {
+                if(!stream.write("error expected " + std::to_string(input_size) + " comma separated features\n")) {
+                    break;
+                }
+                continue;
+            }
+            req.arrived = clock::now();
+            auto done = req.done.get_future();
+            if(!enqueue(req)) {
+                break;
+            }
+            done.wait();
+            if(req.output.empty()) {
+                /**
+                 * Released without being run as the server is stopping
+                 */
+                break;
+            }
+
+            std::ostringstream os;
+            os << std::distance(req.output.begin(), std::max_element(req.output.begin(), req.output.end()));
+            for(auto v : req.output) {
+                os << " " << v;
+            }
+            os << "\n";
+            if(!stream.write(os.str())) {
+                break;
+            }
+        }
+        if(stream.overflowed) {
+            stream.write("error line too long\n");
+        }
+        std::lock_guard<std::mutex> lk(mutex);
+        connections.erase(std::find(connections.begin(), connections.end(), fd));
+        finished.push_back(std::this_thread::get_id());
+        ::close(fd);
+    }
+
+    /**
+     * Parses a line of comma separated finite floats
+     */
+    static bool parse(const std::string& line, vec_t& values) {
+        const char* p = line.c_str();
+        const char* end = p + line.size();
+        while(p < end) {
+            char* next = nullptr;
+            values.push_back(std::strtof(p, &next));
+            if(next == p || !std::isfinite(values.back())) {
+                return false;
+            }
+            p = next;
+            while(p < end && (*p == ' ' || *p == '\t')) {
+                ++p;
+            }
+            if(p < end && (*p++ != ',' || p == end)) {
+                return false;
+            }
+        }
+        return !values.empty();
+    }
+
+    bool enqueue(request& req) {
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            if(stopping) {
+                return false;
+            }
+            pending_requests.push_back(&req);
+            ++pending;
+        }
+        queued.notify_one();
+        return true;
+    }
+
+    /**
+     * Coalesces pending requests into batches, closing a batch once it is
+     * full or its oldest request has waited for the latency budget
+     */
+    void dispatch() {
+        std::unique_lock<std::mutex> lk(mutex);
+        for(;;) {
+            queued.wait(lk, [&] { return stopping || !pending_requests.empty(); });
+            if(stopping) {
+                break;
+            }
+            const auto deadline = pending_requests.front()->arrived + opts.latency_budget;
+            queued.wait_until(lk, deadline, [&] {
+                return stopping || pending_requests.size() >= opts.max_batch;
+            });
+            if(stopping) {
+                break;
+            }
+            const size_t n = std::min(opts.max_batch, pending_requests.size());
+            batch b(pending_requests.begin(), pending_requests.begin() + n);
+            pending_requests.erase(pending_requests.begin(), pending_requests.begin() + n);
+            batches_queued.push_back(std::move(b));
+            batch_queued.notify_one();
+        }
+        /**
+         * Release the requests which will never be run
+         */
+        for(auto req : pending_requests) {
+            req->done.set_value();
+        }
+        pending -= pending_requests.size();
+        for(auto& b : batches_queued) {
+            for(auto req : b) {
+                req->done.set_value();
+            }
+            pending -= b.size();
+        }
+        pending_requests.clear();
+        batches_queued.clear();
+    }
+
+    /**
+     * Runs queued batches through the network
+     */
+    void work() {
+        vec_t in, out, scratch;
+        const size_t input_size = nn.layers.front().input_size;
+        const size_t output_size = nn.layers.back().output_size;
+        for(;;) {
+            batch b;
+            {
+                std::unique_lock<std::mutex> lk(mutex);
+                batch_queued.wait(lk, [&] { return stopping || !batches_queued.empty(); });
+                if(stopping) {
+                    return;
+                }
+                b = std::move(batches_queued.front());
+                batches_queued.pop_front();
+            }
+
+            in.resize(b.size() * input_size);
+            for(size_t i = 0; i < b.size(); ++i) {
+                std::copy(b[i]->input.begin(), b[i]->input.end(), in.begin() + i * input_size);
+            }
+            nn.forward_batch(in, b.size(), out, scratch);
+
+            const auto now = clock::now();
+            for(size_t i = 0; i < b.size(); ++i) {
+                b[i]->output.assign(out.begin() + i * output_size, out.begin() + (i + 1) * output_size);
+                record(std::chrono::duration_cast<std::chrono::microseconds>(now - b[i]->arrived).count());
+            }
+            pending -= b.size();
+            requests += b.size();
+            ++batches;
+            for(auto req : b) {
+                req->done.set_value();
+            }
+        }
+    }
+
+    /**
+     * Records the latency of a request
+     */
+    void record(size_t us) {
+        size_t bucket = 0;
+        while(bucket + 1 < buckets && (size_t(1) << bucket) < us) {
+            ++bucket;
+        }
+        ++histogram[bucket];
+        size_t prev = max_latency;
+        while(prev < us && !max_latency.compare_exchange_weak(prev, us)) {
+        }
+    }
+
+    static constexpr size_t buckets = 32;
+
+    const Network nn;
+    const server_options opts;
+
+    int listen_fd;
+    bool stopping;
+
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::condition_variable batch_queued;
+    std::deque<request*> pending_requests;
+    std::deque<batch> batches_queued;
+
+    std::vector<std::thread> threads;
+    std::vector<std::thread> connection_threads;
+    std::vector<std::thread::id> finished;
+    std::vector<int> connections;
+
+    std::atomic<size_t> pending;
+    std::atomic<size_t> requests;
+    std::atomic<size_t> batches;
+    std::atomic<size_t> max_latency;
+    std::atomic<size_t> histogram[buckets];
+};
+
+/**
+ * Blocking client for an inference_server
+ */
+struct inference_client {
+
+    explicit inference_client(const std::string& address)
+        :   stream(detail::open_socket(address, false)) {}
+
+    ~inference_client() {
+        ::close(stream.fd);
+    }
+
+    inference_client(const inference_client&) = delete;
+    inference_client& operator=(const inference_client&) = delete;
+
+    /**
+     * Sends a sample to the server
+     *
+     * @param sample the input features
+     * @param output receives the network outputs
+     * @return the predicted label
+     */
+    size_t predict(const vec_t& sample, vec_t& output) {
+        std::ostringstream os;
+        os.precision(std::numeric_limits<float_t>::max_digits10);
+        for(size_t i = 0; i < sample.size(); ++i) {
+            os << (i ? "," : "") << sample[i];
+        }
+        os << "\n";
+        std::string line;
+        if(!stream.write(os.str()) || !stream.read_line(line)) {
+            throw mlp_error{"connection closed"};
+        }
+        if(line.compare(0, 5, "error") == 0) {
+            throw mlp_error{line};
+        }
+        std::istringstream is(line);
+        size_t label = 0;
+        is >> label;
+        output.clear();
+        float_t v;
+        while(is >> v) {
+            output.push_back(v);
+        }
+        return label;
+    }
+
+    /**
+     * Returns the server metrics line
+     */
+    std::string stats() {
+        std::string line;
+        if(!stream.write("stats\n") || !stream.read_line(line)) {
+            throw mlp_error{"connection closed"};
+        }
+        return line;
+    }
+
+    detail::line_stream stream;
+};
+
+} /* end namespace mlp */
+
+#endif /* MLP_SERVER_HPP */